@@ -0,0 +1,219 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "morse_encoder.h"
+
+/* CONSTANTS AND TYPES */
+#define MIN_BENCH_TIME_NS 200000000ULL	/* every (corpus, mode) pair is encoded repeatedly for at least this long */
+#define MAX_WORD_LENGTH 8
+#define CORPUS_SEED 1234			/* fixed seed, so runs are comparable between commits */
+#define IRREGULAR_CHAR_CHANCE 64		/* about two in this many bytes of mixed corpus force their block onto scalar path, so most blocks still take vectorized one */
+#define CHECK_ROUNDS 16
+
+const int corpus_sizes[] = {
+	MAX_NUM_OF_CHARS_TO_BE_ENCODED,	/* what driver accepts in single write */
+	1024,
+	64 * 1024,
+	1024 * 1024
+};
+
+/* lengths around 16 and 32 byte block boundaries, plus long ones with many blocks of both kinds */
+const int check_sizes[] = {
+	1, 15, 16, 17, 31, 32, 33, 47, 63, 64, 65, 100, 4099, 64 * 1024
+};
+
+const char regular_chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789    ";
+
+const char irregular_chars[] = {
+	'.', ',', '?', '\'', '!', '/', '(', ')', '&', ':', ';', '=', '+', '-', '_', '"', '$', '@',
+	MORSE_PROSIGN_START, MORSE_PROSIGN_END_OF_MESSAGE, MORSE_PROSIGN_END_OF_WORK,
+	MORSE_PROSIGN_INVITATION, MORSE_PROSIGN_UNDERSTOOD, MORSE_PROSIGN_ERROR,
+	'\0', '\t', '\n', '#', '*', '[', '`', '{', '~', 0x7F
+};
+
+typedef int (*encode_fn)(const char* src, int len, char* dst, work_mode mode);
+
+const char* work_mode_str[] = {
+	"NORMAL",
+	"ERROR"
+};
+
+/* FUNCTION DEFINITIONS */
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+/* generates corpus which respects driver's input expectations: capital letters and digits, words separated by exactly one space */
+static void generateCorpus(char* corpus, int len)
+{
+	int i = 0;
+	int word_left = 1 + rand() % MAX_WORD_LENGTH;
+
+	for (i = 0; i < len; i++){
+		if (word_left == 0 && i != len - 1){
+			corpus[i] = ' ';
+			word_left = 1 + rand() % MAX_WORD_LENGTH;
+		} else{
+			if (rand() % 4 == 0){
+				corpus[i] = (char)(rand() % 10) + 48;
+			} else{
+				corpus[i] = (char)(rand() % 26) + 65;
+			}
+			if (word_left > 0){
+				word_left--;
+			}
+		}
+	}
+}
+
+/* generates what generateCorpus() leaves out: lowercase letters and runs of spaces, with punctuation, prosigns and bytes without Morse representation scattered among them */
+static void generateMixedCorpus(char* corpus, int len)
+{
+	int i = 0;
+	int pick;
+
+	for (i = 0; i < len; i++){
+		pick = rand() % IRREGULAR_CHAR_CHANCE;
+		if (pick == 0){
+			corpus[i] = irregular_chars[rand() % sizeof(irregular_chars)];
+		} else{
+			if (pick == 1){
+				corpus[i] = (char)(rand() % 256);
+			} else{
+				corpus[i] = regular_chars[rand() % (sizeof(regular_chars) - 1)];
+			}
+		}
+	}
+}
+
+static void generateRandomBytes(char* corpus, int len)
+{
+	int i = 0;
+
+	for (i = 0; i < len; i++){
+		corpus[i] = (char)(rand() % 256);
+	}
+}
+
+/* packed (2 bits per symbol) output, which is what driver keeps internally */
+static int encodePacked(const char* src, int len, char* dst, work_mode mode)
+{
+	return morse_encode_packed(src, len, (u8*)dst, 0, mode);
+}
+
+/* vectorized path is only worth measuring if it produces exactly what scalar one does */
+static int bulkMatchesScalar(const char* corpus, int len, char* encoded, char* encoded_ref)
+{
+	int mode = 0;
+	int bulk_len;
+	int ref_len;
+
+	for (mode = NORMAL; mode <= ERROR; mode++){
+		bulk_len = morse_encode_bulk(corpus, len, encoded, mode);
+		ref_len = morse_encode(corpus, len, encoded_ref, mode);
+		if (bulk_len != ref_len || memcmp(encoded, encoded_ref, ref_len) != 0){
+			printf("%s output differs from scalar one (%d chars, %s mode)\n", morse_encode_bulk_isa(), len, work_mode_str[mode]);
+			return 0;
+		}
+	}
+
+	return 1;
+}
+
+/* benchmark corpus keeps every block on vectorized path, so lowercase folding and scalar fallback are checked separately */
+static int bulkMatchesScalarOnMixed(char* corpus, char* encoded, char* encoded_ref)
+{
+	int num_of_sizes = sizeof(check_sizes) / sizeof(check_sizes[0]);
+	int i = 0;
+	int round = 0;
+
+	srand(CORPUS_SEED);
+	for (i = 0; i < num_of_sizes; i++){
+		for (round = 0; round < CHECK_ROUNDS; round++){
+			generateMixedCorpus(corpus, check_sizes[i]);
+			if (!bulkMatchesScalar(corpus, check_sizes[i], encoded, encoded_ref)){
+				return 0;
+			}
+			generateRandomBytes(corpus, check_sizes[i]);
+			if (!bulkMatchesScalar(corpus, check_sizes[i], encoded, encoded_ref)){
+				return 0;
+			}
+		}
+	}
+
+	return 1;
+}
+
+static void benchCorpus(const char* corpus, int len, char* encoded, work_mode mode, encode_fn encoder, const char* path)
+{
+	unsigned long long start;
+	unsigned long long elapsed;
+	unsigned long long iterations = 0;
+	volatile int encoded_len = 0;
+	double ns_per_char;
+
+	start = now_ns();
+	do {
+		encoded_len = encoder(corpus, len, encoded, mode);
+		iterations++;
+		elapsed = now_ns() - start;
+	} while (elapsed < MIN_BENCH_TIME_NS);
+
+	ns_per_char = (double)elapsed / ((double)iterations * len);
+
+	printf("%10d %8s %8s %12d %16.0f %10.2f\n", len, work_mode_str[mode], path, encoded_len, 1e9 / ns_per_char, ns_per_char);
+}
+
+int main(int argc, char* argv[])
+{
+	int num_of_sizes = sizeof(corpus_sizes) / sizeof(corpus_sizes[0]);
+	int max_size = corpus_sizes[num_of_sizes - 1];
+	char* corpus;
+	char* encoded;
+	char* encoded_ref;
+	int i = 0;
+
+	corpus = malloc(max_size);
+	encoded = malloc((size_t)max_size * ENCODED_CHAR_MAX_LENGTH);
+	encoded_ref = malloc((size_t)max_size * ENCODED_CHAR_MAX_LENGTH);
+	if (corpus == NULL || encoded == NULL || encoded_ref == NULL){
+		printf("Allocation failed\n");
+		return -1;
+	}
+
+	if (!bulkMatchesScalarOnMixed(corpus, encoded, encoded_ref)){
+		return -1;
+	}
+
+	printf("%10s %8s %8s %12s %16s %10s\n", "chars", "mode", "path", "encoded", "bytes/s", "ns/char");
+
+	for (i = 0; i < num_of_sizes; i++){
+		srand(CORPUS_SEED);
+		generateCorpus(corpus, corpus_sizes[i]);
+
+		if (!bulkMatchesScalar(corpus, corpus_sizes[i], encoded, encoded_ref)){
+			return -1;
+		}
+
+		benchCorpus(corpus, corpus_sizes[i], encoded, NORMAL, morse_encode, "scalar");
+		benchCorpus(corpus, corpus_sizes[i], encoded, NORMAL, morse_encode_bulk, morse_encode_bulk_isa());
+		benchCorpus(corpus, corpus_sizes[i], encoded, NORMAL, encodePacked, "packed");
+		benchCorpus(corpus, corpus_sizes[i], encoded, ERROR, morse_encode, "scalar");
+		benchCorpus(corpus, corpus_sizes[i], encoded, ERROR, morse_encode_bulk, morse_encode_bulk_isa());
+		benchCorpus(corpus, corpus_sizes[i], encoded, ERROR, encodePacked, "packed");
+	}
+
+	free(corpus);
+	free(encoded);
+	free(encoded_ref);
+
+	return 0;
+}
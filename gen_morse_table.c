@@ -0,0 +1,176 @@
+/* Host tool which generates morse_table.h (256-entry packed lookup table used by morse_encoder.c). It is run at build time, both by kbuild and by bench/Makefile, so table is never edited by hand */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "morse_encoder.h"
+
+/* CONSTANTS AND TYPES */
+#define WORD_SEPARATOR_GAP 4	/* 3 units after last character + 4 more -> 7 units between words */
+#define CHAR_SEPARATOR_GAP 2	/* 1 unit after last element + 2 more -> 3 units between characters */
+
+typedef struct {
+	unsigned char c;
+	const char* code;	/* '.' is dot, '-' is dash */
+} morse_code;
+
+/* ITU-R M.1677-1 alphabet, figures, punctuation and prosigns, plus commonly used non-ITU punctuation */
+const morse_code codes[] = {
+	{ 'A', ".-" },
+	{ 'B', "-..." },
+	{ 'C', "-.-." },
+	{ 'D', "-.." },
+	{ 'E', "." },
+	{ 'F', "..-." },
+	{ 'G', "--." },
+	{ 'H', "...." },
+	{ 'I', ".." },
+	{ 'J', ".---" },
+	{ 'K', "-.-" },
+	{ 'L', ".-.." },
+	{ 'M', "--" },
+	{ 'N', "-." },
+	{ 'O', "---" },
+	{ 'P', ".--." },
+	{ 'Q', "--.-" },
+	{ 'R', ".-." },
+	{ 'S', "..." },
+	{ 'T', "-" },
+	{ 'U', "..-" },
+	{ 'V', "...-" },
+	{ 'W', ".--" },
+	{ 'X', "-..-" },
+	{ 'Y', "-.--" },
+	{ 'Z', "--.." },
+	{ '0', "-----" },
+	{ '1', ".----" },
+	{ '2', "..---" },
+	{ '3', "...--" },
+	{ '4', "....-" },
+	{ '5', "....." },
+	{ '6', "-...." },
+	{ '7', "--..." },
+	{ '8', "---.." },
+	{ '9', "----." },
+	{ '.', ".-.-.-" },
+	{ ',', "--..--" },
+	{ ':', "---..." },
+	{ '?', "..--.." },
+	{ '\'', ".----." },
+	{ '-', "-....-" },
+	{ '/', "-..-." },
+	{ '(', "-.--." },
+	{ ')', "-.--.-" },
+	{ '"', ".-..-." },
+	{ '=', "-...-" },
+	{ '+', ".-.-." },
+	{ '@', ".--.-." },
+	{ '&', ".-..." },	/* also "wait" prosign */
+	{ '!', "-.-.--" },	/* non-ITU */
+	{ ';', "-.-.-." },	/* non-ITU */
+	{ '_', "..--.-" },	/* non-ITU */
+	{ '$', "...-..-" },	/* non-ITU */
+	{ MORSE_PROSIGN_START, "-.-.-" },
+	{ MORSE_PROSIGN_END_OF_MESSAGE, ".-.-." },
+	{ MORSE_PROSIGN_END_OF_WORK, "...-.-" },
+	{ MORSE_PROSIGN_INVITATION, "-.-" },
+	{ MORSE_PROSIGN_UNDERSTOOD, "...-." },
+	{ MORSE_PROSIGN_ERROR, "........" }
+};
+
+/* bytes which are transmitted as word separator */
+const unsigned char word_separators[] = { ' ', '\t', '\n', '\r' };
+
+static unsigned int packCode(const char* code, int letter)
+{
+	unsigned int mask = 0;
+	unsigned int len = strlen(code);
+	unsigned int i = 0;
+
+	for (i = 0; i < len; i++){
+		if (code[i] == '-'){
+			mask |= 1 << i;
+		}
+	}
+
+	return MORSE_ENTRY(mask, len, CHAR_SEPARATOR_GAP, letter);
+}
+
+/* pre-rendered output of letters, digits and space for both work modes, used by vectorized encoders which store it with one 16-byte move per character. They exist only in user space, so kernel build leaves it out */
+static void printRendered(const unsigned int* table)
+{
+	char rendered[MORSE_RENDERED_WIDTH];
+	unsigned int entry;
+	unsigned int len;
+	int mode = 0;
+	int c = 0;
+	int i = 0;
+
+	printf("\n#ifndef __KERNEL__\n");
+	printf("const u8 morse_rendered[2][128][MORSE_RENDERED_WIDTH] = {\n");
+	for (mode = NORMAL; mode <= ERROR; mode++){
+		printf("\t{\n");
+		for (c = 0; c < 128; c++){
+			memset(rendered, ' ', sizeof(rendered));
+			entry = table[c];
+			len = 0;
+			if ((c >= 'A' && c <= 'Z') || (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == ' '){
+				if (MORSE_ENTRY_LETTER(entry) && mode == ERROR){
+					rendered[len++] = '*';
+					rendered[len++] = ' ';
+				}
+				for (i = 0; i < MORSE_ENTRY_LEN(entry); i++){
+					rendered[len] = (MORSE_ENTRY_MASK(entry) & (1 << i)) ? '-' : '*';
+					len += 2;
+				}
+			} else{
+				memset(rendered, 0, sizeof(rendered)); /* never used, such bytes take scalar path */
+			}
+			printf("\t\t{");
+			for (i = 0; i < MORSE_RENDERED_WIDTH; i++){
+				printf(" 0x%02x,", (unsigned char)rendered[i]);
+			}
+			printf(" }, /* 0x%02x */\n", c);
+		}
+		printf("\t},\n");
+	}
+	printf("};\n");
+	printf("#endif\n");
+}
+
+int main(void)
+{
+	unsigned int table[256];
+	unsigned int i = 0;
+	int letter;
+
+	memset(table, 0, sizeof(table)); /* everything not listed bellow is silently dropped */
+
+	for (i = 0; i < sizeof(codes) / sizeof(codes[0]); i++){
+		if (strlen(codes[i].code) > MORSE_MAX_ELEMENTS){
+			fprintf(stderr, "Code for 0x%02x is too long\n", codes[i].c);
+			return 1;
+		}
+		letter = (codes[i].c >= 'A' && codes[i].c <= 'Z');
+		table[codes[i].c] = packCode(codes[i].code, letter);
+		if (letter){
+			/* lowercase folding */
+			table[codes[i].c - 'A' + 'a'] = table[codes[i].c];
+		}
+	}
+
+	for (i = 0; i < sizeof(word_separators); i++){
+		table[word_separators[i]] = MORSE_ENTRY(0, 0, WORD_SEPARATOR_GAP, 0);
+	}
+
+	printf("/* Generated by gen_morse_table, do not edit */\n\n");
+	printf("const u16 morse_table[256] = {\n");
+	for (i = 0; i < 256; i++){
+		printf("\t0x%04x,%s", table[i], (i % 8 == 7) ? "\n" : "");
+	}
+	printf("};\n");
+
+	printRendered(table);
+
+	return 0;
+}
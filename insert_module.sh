@@ -17,10 +17,16 @@ echo "#### INSERTING THE MODULE ####"
 
 insmod morse_dev.ko
 
-major=$(cat /proc/devices | sed -n '/morse_dev/{s/[^0-9]//g;p}')
-
-mknod /dev/morse_dev c ${major} 0
-RET=$?
+# nodes /dev/morse_dev<N> (one per transmitter) are created by udev/mdev where they run (driver registers class morse), otherwise by hand
+RET=0
+for class_dev in /sys/class/morse/morse_dev*;
+do
+ node=/dev/$(basename ${class_dev})
+ if [ ! -e ${node} ];
+ then
+  mknod ${node} c $(cut -d: -f1 ${class_dev}/dev) $(cut -d: -f2 ${class_dev}/dev) || RET=1
+ fi
+done
 if [ ${RET} == 0 ];
 then
  echo "### INSERTING MODULE SUCCSEFUL ###"
@@ -0,0 +1,241 @@
+#include "morse_encoder.h"
+#include "morse_table.h" /* generated by gen_morse_table at build time */
+
+#ifdef __KERNEL__
+#include <asm/byteorder.h>
+#define morse_le64(x) cpu_to_le64(x)
+#else
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+#define morse_le64(x) __builtin_bswap64(x)
+#else
+#define morse_le64(x) (x)
+#endif
+#endif
+
+/* rendering of 4 elements as "e e e e " in single 64-bit word: bit i of mask is moved to bit 16*i by multiplication (shifted copies never overlap, so there are no carries) and dash is then 3 above dot ('-' - '*') */
+#define SPREAD_4_BITS_MUL 	0x0000200040008001ULL
+#define SPREAD_4_BITS_MASK 	0x0001000100010001ULL
+#define DOTS_AND_GAPS 		0x202A202A202A202AULL
+
+static inline u64 renderElements(u32 mask)
+{
+	return morse_le64(DOTS_AND_GAPS + 3 * (((mask & 0xF) * SPREAD_4_BITS_MUL) & SPREAD_4_BITS_MASK));
+}
+
+int morse_encode(const char* src, int len, char* dst, work_mode mode)
+{
+	char* out = dst;
+	u64 chunk;
+	u32 entry;
+	int i = 0;
+
+	for (i = 0; i < len; i++){
+		/* single lookup per character, everything bellow is stored unconditionally and only output pointer advance depends on entry */
+		entry = morse_table[(u8)src[i]];
+
+		/* "* " is kept only for letters in ERROR mode */
+		out[0] = '*';
+		out[1] = ' ';
+		out += (MORSE_ENTRY_LETTER(entry) & mode) << 1;
+
+		/* up to 8 elements, each followed by one unit gap */
+		chunk = renderElements(MORSE_ENTRY_MASK(entry));
+		memcpy(out, &chunk, sizeof(chunk));
+		chunk = renderElements(MORSE_ENTRY_MASK(entry) >> 4);
+		memcpy(out + sizeof(chunk), &chunk, sizeof(chunk));
+		out += MORSE_ENTRY_LEN(entry) << 1;
+
+		/* character or word separator */
+		memcpy(out, "    ", 4);
+		out += MORSE_ENTRY_GAP(entry);
+	}
+
+	return out - dst;
+}
+
+/* bit i of nibble moved to bit 4*i, i.e. to the place of i-th element in packed stream (each element is followed by gap symbol) */
+static const u16 spread_nibble[16] = {
+	0x0000, 0x0001, 0x0010, 0x0011, 0x0100, 0x0101, 0x0110, 0x0111,
+	0x1000, 0x1001, 0x1010, 0x1011, 0x1100, 0x1101, 0x1110, 0x1111
+};
+
+int morse_encode_packed(const char* src, int len, u8* dst, int first, work_mode mode)
+{
+	u8* out = dst + first / MORSE_SYMS_PER_BYTE;
+	u32 bits = (first % MORSE_SYMS_PER_BYTE) * 2;
+	u64 acc = *out & ((1U << bits) - 1);	/* keep symbols already stored in first byte */
+	u64 elements;
+	u64 chunk;
+	u32 entry;
+	u32 prefixed;
+	u32 n;
+	int symbols = 0;
+	int i = 0;
+
+	for (i = 0; i < len; i++){
+		entry = morse_table[(u8)src[i]];
+		n = MORSE_ENTRY_LEN(entry);
+		prefixed = MORSE_ENTRY_LETTER(entry) & mode;
+
+		/* "* " in ERROR mode -> DOT, GAP */
+		acc |= (u64)(prefixed * MORSE_SYM_DOT) << bits;
+		bits += prefixed * 4;
+
+		/* each element is DOT (1) or DASH (2 = 1 + dash bit) followed by GAP (0) */
+		elements = (0x11111111ULL & ((1ULL << (n * 4)) - 1)) + (spread_nibble[MORSE_ENTRY_MASK(entry) & 0xF] | ((u64)spread_nibble[MORSE_ENTRY_MASK(entry) >> 4] << 16));
+		acc |= elements << bits;
+
+		/* separator symbols are GAP, i.e. zeros which are already there */
+		bits += n * 4 + MORSE_ENTRY_GAP(entry) * 2;
+		symbols += prefixed * 2 + n * 2 + MORSE_ENTRY_GAP(entry);
+
+		/* store whole accumulator and advance only by completed bytes (no more than 52 bits are ever pending, so shift stays below 64) */
+		chunk = morse_le64(acc);
+		memcpy(out, &chunk, sizeof(chunk));
+		out += bits / 8;
+		acc >>= bits & ~7U;
+		bits &= 7;
+	}
+
+	return symbols;
+}
+
+void morse_render(const u8* packed, int first, int count, char* dst)
+{
+	static const char symbol_char[4] = { ' ', '*', '-', ' ' };
+	int i = 0;
+
+	for (i = 0; i < count; i++){
+		dst[i] = symbol_char[morse_symbol(packed, first + i)];
+	}
+}
+
+/* LED state and duration (in units) of every symbol */
+static const u8 symbol_led_on[4] = { 0, 1, 1, 0 };
+static const u8 symbol_units[4] = { 1, 1, 3, 1 };
+
+int morse_schedule(const u8* packed, int first, int count, morse_run* runs)
+{
+	u32 symbol;
+	int num_of_runs = 0;
+	int i = 0;
+
+	for (i = 0; i < count; i++){
+		symbol = morse_symbol(packed, first + i);
+		/* new run on every LED change, or when units would overflow (such run then starts without real edge) */
+		if (num_of_runs == 0 || runs[num_of_runs - 1].led_on != symbol_led_on[symbol] || runs[num_of_runs - 1].units > 0xFFFF - 3){
+			runs[num_of_runs].units = 0;
+			runs[num_of_runs].led_on = symbol_led_on[symbol];
+			num_of_runs++;
+		}
+		runs[num_of_runs - 1].units += symbol_units[symbol];
+	}
+
+	return num_of_runs;
+}
+
+int morse_schedule_lanes(const u8* packed, const int* first, const int* count, int lanes, morse_run* runs)
+{
+	u32 index[MORSE_MAX_LANES];
+	u32 end[MORSE_MAX_LANES];
+	u32 left[MORSE_MAX_LANES];	/* units left of current symbol of lane */
+	u32 symbol;
+	u32 step;
+	u32 on;
+	int num_of_runs = 0;
+	int active;
+	int i = 0;
+
+	for (i = 0; i < lanes; i++){
+		index[i] = first[i];
+		end[i] = first[i] + count[i];
+		left[i] = (count[i] > 0) ? symbol_units[morse_symbol(packed, index[i])] : 0;
+	}
+
+	/* every step ends at least one symbol of some lane, so there are never more runs than symbols */
+	while (1){
+		on = 0;
+		step = 0xFFFF;
+		active = 0;
+		for (i = 0; i < lanes; i++){
+			if (index[i] < end[i]){
+				active = 1;
+				on |= symbol_led_on[morse_symbol(packed, index[i])] << i;
+				if (left[i] < step){
+					step = left[i];
+				}
+			}
+		}
+		if (!active){
+			break;
+		}
+
+		if (num_of_runs == 0 || runs[num_of_runs - 1].led_on != on || runs[num_of_runs - 1].units > 0xFFFF - step){
+			runs[num_of_runs].units = 0;
+			runs[num_of_runs].led_on = on;
+			num_of_runs++;
+		}
+		runs[num_of_runs - 1].units += step;
+
+		for (i = 0; i < lanes; i++){
+			if (index[i] < end[i]){
+				left[i] -= step;
+				if (left[i] == 0 && ++index[i] < end[i]){
+					symbol = morse_symbol(packed, index[i]);
+					left[i] = symbol_units[symbol];
+				}
+			}
+		}
+	}
+
+	return num_of_runs;
+}
+
+#ifndef __KERNEL__
+typedef int (*encode_fn)(const char* src, int len, char* dst, work_mode mode);
+
+/* picks best encoder for long inputs, scalar one if nothing better is available */
+static encode_fn bulkEncoder(const char** isa)
+{
+#if !defined(__KERNEL__) && (defined(__x86_64__) || defined(__i386__))
+	if (__builtin_cpu_supports("avx2")){
+		*isa = "avx2";
+		return morse_encode_avx2;
+	}
+	if (__builtin_cpu_supports("sse4.1")){
+		*isa = "sse4.1";
+		return morse_encode_sse41;
+	}
+#elif (defined(__ARM_NEON) || defined(__ARM_NEON__))
+	*isa = "neon";
+	return morse_encode_neon;
+#endif
+	*isa = "scalar";
+	return morse_encode;
+}
+
+int morse_encode_bulk(const char* src, int len, char* dst, work_mode mode)
+{
+	const char* isa;
+	encode_fn encoder;
+	int encoded;
+
+	if (len < MORSE_BULK_MIN_LENGTH){
+		return morse_encode(src, len, dst, mode);
+	}
+
+	encoder = bulkEncoder(&isa);
+	encoded = encoder(src, len, dst, mode);
+
+	return encoded;
+}
+
+const char* morse_encode_bulk_isa(void)
+{
+	const char* isa;
+
+	bulkEncoder(&isa);
+
+	return isa;
+}
+#endif /* __KERNEL__ */
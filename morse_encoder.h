@@ -0,0 +1,100 @@
+#ifndef MORSE_ENCODER_H
+#define MORSE_ENCODER_H
+
+/* Text -> Morse encoder core. This file is shared between the kernel module (morse_dev.ko) and userspace static library (libmorse_encoder.a), so it may only use what is available in both worlds */
+
+#ifdef __KERNEL__
+#include <linux/types.h>
+#include <linux/string.h>
+#else
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+typedef uint8_t u8;
+typedef uint16_t u16;
+typedef uint32_t u32;
+typedef uint64_t u64;
+#endif
+
+/* CONSTANTS AND TYPES */
+#define ENCODED_CHAR_MAX_LENGTH 	     20 /* the worst case is error prosign (8 dots): 8 * (1+1) + 2 separators, plus 2 bytes of slack because encoder stores fixed size chunks */
+#define MAX_NUM_OF_CHARS_TO_BE_ENCODED 	     50	/* max num of chars that user app can pass */
+#define MORSE_MAX_ELEMENTS 		      8 /* max num of dots and dashes in single character */
+#define MORSE_BULK_MIN_LENGTH 		     64 /* below this input length vectorized encoder doesn't pay off */
+#define MORSE_RENDERED_WIDTH 		     16 /* size of pre-rendered letter, digit or space (incl. ERROR prefix and separators) */
+#define MORSE_MAX_LANES 		      8 /* max num of LEDs message can be striped across */
+
+/* packed representation: every element or one unit gap is 2-bit symbol, 4 symbols per byte, first symbol in lowest bits */
+#define MORSE_SYM_GAP 			      0 /* LED off for 1 unit */
+#define MORSE_SYM_DOT 			      1 /* LED on for 1 unit */
+#define MORSE_SYM_DASH 			      2 /* LED on for 3 units */
+#define MORSE_SYMS_PER_BYTE 		      4
+#define MORSE_PACKED_SLACK 		      8 /* packed encoder stores whole 64-bit words, so buffers need this many spare bytes at the end */
+#define MORSE_PACKED_SIZE(syms) 	(((syms) + MORSE_SYMS_PER_BYTE - 1) / MORSE_SYMS_PER_BYTE)
+
+/* prosigns, sent as ASCII control bytes with matching meaning */
+#define MORSE_PROSIGN_START 		   0x02 /* STX -> starting signal (-.-.-) */
+#define MORSE_PROSIGN_END_OF_MESSAGE 	   0x03 /* ETX -> end of message (.-.-.) */
+#define MORSE_PROSIGN_END_OF_WORK 	   0x04 /* EOT -> end of work (...-.-) */
+#define MORSE_PROSIGN_INVITATION 	   0x05 /* ENQ -> invitation to transmit (-.-) */
+#define MORSE_PROSIGN_UNDERSTOOD 	   0x06 /* ACK -> understood (...-.) */
+#define MORSE_PROSIGN_ERROR 		   0x08 /* BS  -> error (........) */
+
+/* morse_table entry layout: bits 0-7 element mask (bit i set -> element i is dash), bits 8-11 num of elements, bits 12-14 num of separator units appended after last element, bit 15 set for letters (they get "* " prefix in ERROR mode) */
+#define MORSE_ENTRY(mask, len, gap, letter) 	((mask) | ((len) << 8) | ((gap) << 12) | ((letter) << 15))
+#define MORSE_ENTRY_MASK(e) 			((e) & 0xFF)
+#define MORSE_ENTRY_LEN(e) 			(((e) >> 8) & 0xF)
+#define MORSE_ENTRY_GAP(e) 			(((e) >> 12) & 0x7)
+#define MORSE_ENTRY_LETTER(e) 			(((e) >> 15) & 0x1)
+
+typedef enum {
+	NORMAL,
+	ERROR
+} work_mode;
+
+/* one run of LED edge schedule: LED is switched to led_on at start of run and held for units. In schedule of striped message bit i of led_on is state of lane i */
+typedef struct {
+	u16 units;
+	u16 led_on;
+} morse_run;
+
+/* generated by gen_morse_table (morse_table.h) */
+extern const u16 morse_table[256];
+
+/* Encodes len characters from src into dst and returns number of encoded elements written. dst has to provide at least len * ENCODED_CHAR_MAX_LENGTH bytes. Bytes without Morse representation are dropped */
+int morse_encode(const char* src, int len, char* dst, work_mode mode);
+
+/* Same as morse_encode(), but output is packed. Symbols are appended to dst starting at symbol index first (symbols before it are preserved), returns num of symbols written. dst has to provide at least MORSE_PACKED_SIZE(first + len * ENCODED_CHAR_MAX_LENGTH) + MORSE_PACKED_SLACK bytes */
+int morse_encode_packed(const char* src, int len, u8* dst, int first, work_mode mode);
+
+/* Renders count packed symbols starting from symbol index first as '*', '-' and ' ' (same output morse_encode() produces) */
+void morse_render(const u8* packed, int first, int count, char* dst);
+
+/* Builds run-length edge schedule of count packed symbols starting from symbol index first. Consecutive symbols with same LED state are merged, so every run starts with an LED edge. Returns num of runs written, runs has to provide count entries */
+int morse_schedule(const u8* packed, int first, int count, morse_run* runs);
+
+/* Builds edge schedule of lanes shown in parallel, lane i being count[i] packed symbols starting from symbol index first[i] (lanes which already ended stay off). Edges of all lanes are merged, so every run starts with an edge of at least one lane. Returns num of runs written, runs has to provide sum of count entries */
+int morse_schedule_lanes(const u8* packed, const int* first, const int* count, int lanes, morse_run* runs);
+
+static inline u32 morse_symbol(const u8* packed, u32 index)
+{
+	return (packed[index / MORSE_SYMS_PER_BYTE] >> ((index % MORSE_SYMS_PER_BYTE) * 2)) & 0x3;
+}
+
+#ifndef __KERNEL__
+/* pre-rendered letters, digits and space of vectorized encoders, [work_mode][ASCII] (generated only for user space) */
+extern const u8 morse_rendered[2][128][MORSE_RENDERED_WIDTH];
+
+/* Same as morse_encode(), but uses vectorized encoder for long inputs when CPU supports it. Output is byte-identical to morse_encode() */
+int morse_encode_bulk(const char* src, int len, char* dst, work_mode mode);
+
+/* Name of instruction set morse_encode_bulk() uses for long inputs ("avx2", "sse4.1", "neon" or "scalar") */
+const char* morse_encode_bulk_isa(void);
+
+/* vectorized encoders (morse_encoder_simd.c), only those supported by build target exist */
+int morse_encode_sse41(const char* src, int len, char* dst, work_mode mode);
+int morse_encode_avx2(const char* src, int len, char* dst, work_mode mode);
+int morse_encode_neon(const char* src, int len, char* dst, work_mode mode);
+#endif /* __KERNEL__ */
+
+#endif /* MORSE_ENCODER_H */
@@ -0,0 +1,225 @@
+/* Vectorized bulk encoders (SSE4.1 and AVX2 on x86 hosts, NEON on ARM). Input is classified and normalized 16 (or 32) bytes at a time. If whole block consists of letters, digits and spaces, codes of its characters are fetched from morse_table (gathered on AVX2), their output offsets are computed with in-register prefix sum over encoded lengths and every character is then expanded with one 16-byte move of its pre-rendered form (morse_rendered), so stores within block are independent of each other. Any other block (punctuation, prosigns, dropped bytes) goes through scalar morse_encode(), so output is byte-identical to it. It is built only into user space library (bench/), kernel module never gets inputs long enough for it */
+
+#include "morse_encoder.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define MORSE_SIMD_X86
+#endif
+
+#if defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MORSE_SIMD_NEON
+#endif
+
+/* CONSTANTS AND TYPES */
+#define SIMD_BLOCK 		16
+#define SIMD_BLOCK_AVX2 	32
+
+#ifdef MORSE_SIMD_X86
+
+/* classifies block of 16 bytes, returns normalized (lowercase folded) block and nonzero if every byte is letter, digit or space */
+__attribute__((target("sse4.1")))
+static inline int classifySse(__m128i in, __m128i* normalized)
+{
+	__m128i upper = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('A' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('Z' + 1)));
+	__m128i lower = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('a' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('z' + 1)));
+	__m128i digit = _mm_and_si128(_mm_cmpgt_epi8(in, _mm_set1_epi8('0' - 1)), _mm_cmplt_epi8(in, _mm_set1_epi8('9' + 1)));
+	__m128i space = _mm_cmpeq_epi8(in, _mm_set1_epi8(' '));
+	__m128i valid = _mm_or_si128(_mm_or_si128(upper, lower), _mm_or_si128(digit, space));
+
+	*normalized = _mm_sub_epi8(in, _mm_and_si128(lower, _mm_set1_epi8(0x20)));
+
+	return _mm_movemask_epi8(valid) == 0xFFFF;
+}
+
+/* emits 8 characters whose table entries are already fetched (one per 16-bit lane). Their output offsets are exclusive prefix sum of encoded lengths, so 16-byte stores of their pre-rendered forms don't depend on each other */
+#define EMIT_LANE(k) 	_mm_storeu_si128((__m128i*)(out + _mm_extract_epi16(offsets, k)), _mm_loadu_si128((const __m128i*)rendered[chars[k]]))
+
+__attribute__((target("sse4.1")))
+static inline char* emitSse8(char* out, __m128i entries, const u8* chars, u32 mode)
+{
+	const u8 (*rendered)[MORSE_RENDERED_WIDTH] = morse_rendered[mode];
+	__m128i prefixed = _mm_and_si128(_mm_srli_epi16(entries, 15), _mm_set1_epi16(mode));
+	__m128i len = _mm_and_si128(_mm_srli_epi16(entries, 8), _mm_set1_epi16(0xF));
+	__m128i gap = _mm_and_si128(_mm_srli_epi16(entries, 12), _mm_set1_epi16(0x7));
+	__m128i total = _mm_add_epi16(_mm_slli_epi16(_mm_add_epi16(prefixed, len), 1), gap);
+	__m128i sum = total;
+	__m128i offsets;
+
+	sum = _mm_add_epi16(sum, _mm_slli_si128(sum, 2));
+	sum = _mm_add_epi16(sum, _mm_slli_si128(sum, 4));
+	sum = _mm_add_epi16(sum, _mm_slli_si128(sum, 8));
+	offsets = _mm_sub_epi16(sum, total);
+
+	EMIT_LANE(0);
+	EMIT_LANE(1);
+	EMIT_LANE(2);
+	EMIT_LANE(3);
+	EMIT_LANE(4);
+	EMIT_LANE(5);
+	EMIT_LANE(6);
+	EMIT_LANE(7);
+
+	return out + _mm_extract_epi16(sum, 7);
+}
+
+__attribute__((target("sse4.1")))
+int morse_encode_sse41(const char* src, int len, char* dst, work_mode mode)
+{
+	u8 normalized[SIMD_BLOCK];
+	u16 entries[SIMD_BLOCK];
+	char* out = dst;
+	__m128i block;
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; i + SIMD_BLOCK <= len; i += SIMD_BLOCK){
+		if (classifySse(_mm_loadu_si128((const __m128i*)(src + i)), &block)){
+			_mm_storeu_si128((__m128i*)normalized, block);
+			for (j = 0; j < SIMD_BLOCK; j++){
+				entries[j] = morse_table[normalized[j]];
+			}
+			out = emitSse8(out, _mm_loadu_si128((const __m128i*)entries), normalized, mode);
+			out = emitSse8(out, _mm_loadu_si128((const __m128i*)(entries + 8)), normalized + 8, mode);
+		} else{
+			out += morse_encode(src + i, SIMD_BLOCK, out, mode);
+		}
+	}
+
+	/* tail shorter than one block */
+	out += morse_encode(src + i, len - i, out, mode);
+
+	return out - dst;
+}
+
+__attribute__((target("avx2")))
+int morse_encode_avx2(const char* src, int len, char* dst, work_mode mode)
+{
+	u8 normalized[SIMD_BLOCK_AVX2];
+	char* out = dst;
+	__m256i in;
+	__m256i upper;
+	__m256i lower;
+	__m256i digit;
+	__m256i space;
+	__m256i valid;
+	__m256i index;
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; i + SIMD_BLOCK_AVX2 <= len; i += SIMD_BLOCK_AVX2){
+		in = _mm256_loadu_si256((const __m256i*)(src + i));
+		upper = _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('A' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), in));
+		lower = _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('a' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('z' + 1), in));
+		digit = _mm256_and_si256(_mm256_cmpgt_epi8(in, _mm256_set1_epi8('0' - 1)), _mm256_cmpgt_epi8(_mm256_set1_epi8('9' + 1), in));
+		space = _mm256_cmpeq_epi8(in, _mm256_set1_epi8(' '));
+		valid = _mm256_or_si256(_mm256_or_si256(upper, lower), _mm256_or_si256(digit, space));
+
+		if ((u32)_mm256_movemask_epi8(valid) != 0xFFFFFFFFU){
+			out += morse_encode(src + i, SIMD_BLOCK_AVX2, out, mode);
+			continue;
+		}
+
+		in = _mm256_sub_epi8(in, _mm256_and_si256(lower, _mm256_set1_epi8(0x20)));
+		_mm256_storeu_si256((__m256i*)normalized, in);
+
+		/* gather 8 entries at once. 32-bit lanes read entry and its neighbour (valid bytes are far from end of table), upper half is masked and lanes are packed to 16 bits */
+		for (j = 0; j < SIMD_BLOCK_AVX2; j += 8){
+			index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(normalized + j)));
+			index = _mm256_and_si256(_mm256_i32gather_epi32((const int*)morse_table, index, 2), _mm256_set1_epi32(0xFFFF));
+			out = emitSse8(out, _mm_packus_epi32(_mm256_castsi256_si128(index), _mm256_extracti128_si256(index, 1)), normalized + j, mode);
+		}
+	}
+
+	/* tail shorter than one block */
+	out += morse_encode(src + i, len - i, out, mode);
+
+	return out - dst;
+}
+
+#endif /* MORSE_SIMD_X86 */
+
+#ifdef MORSE_SIMD_NEON
+
+/* classifies block of 16 bytes, returns normalized (lowercase folded) block and nonzero if every byte is letter, digit or space */
+static inline int classifyNeon(uint8x16_t in, uint8x16_t* normalized)
+{
+	uint8x16_t upper = vandq_u8(vcgeq_u8(in, vdupq_n_u8('A')), vcleq_u8(in, vdupq_n_u8('Z')));
+	uint8x16_t lower = vandq_u8(vcgeq_u8(in, vdupq_n_u8('a')), vcleq_u8(in, vdupq_n_u8('z')));
+	uint8x16_t digit = vandq_u8(vcgeq_u8(in, vdupq_n_u8('0')), vcleq_u8(in, vdupq_n_u8('9')));
+	uint8x16_t space = vceqq_u8(in, vdupq_n_u8(' '));
+	uint8x16_t valid = vorrq_u8(vorrq_u8(upper, lower), vorrq_u8(digit, space));
+	uint8x8_t all;
+
+	*normalized = vsubq_u8(in, vandq_u8(lower, vdupq_n_u8(0x20)));
+
+	/* horizontal AND, written with pairwise min so it works on ARMv7 as well */
+	all = vand_u8(vget_low_u8(valid), vget_high_u8(valid));
+	all = vpmin_u8(all, all);
+	all = vpmin_u8(all, all);
+	all = vpmin_u8(all, all);
+
+	return vget_lane_u8(all, 0) == 0xFF;
+}
+
+/* emits 8 characters whose table entries are already fetched (one per 16-bit lane). Their output offsets are exclusive prefix sum of encoded lengths, so 16-byte stores of their pre-rendered forms don't depend on each other */
+#define EMIT_LANE_NEON(k) 	vst1q_u8((u8*)(out + vgetq_lane_u16(offsets, k)), vld1q_u8(rendered[chars[k]]))
+
+static inline char* emitNeon8(char* out, uint16x8_t entries, const u8* chars, u32 mode)
+{
+	const u8 (*rendered)[MORSE_RENDERED_WIDTH] = morse_rendered[mode];
+	const uint16x8_t zero = vdupq_n_u16(0);
+	uint16x8_t prefixed = vandq_u16(vshrq_n_u16(entries, 15), vdupq_n_u16(mode));
+	uint16x8_t len = vandq_u16(vshrq_n_u16(entries, 8), vdupq_n_u16(0xF));
+	uint16x8_t gap = vandq_u16(vshrq_n_u16(entries, 12), vdupq_n_u16(0x7));
+	uint16x8_t total = vaddq_u16(vshlq_n_u16(vaddq_u16(prefixed, len), 1), gap);
+	uint16x8_t sum = total;
+	uint16x8_t offsets;
+
+	sum = vaddq_u16(sum, vextq_u16(zero, sum, 7));
+	sum = vaddq_u16(sum, vextq_u16(zero, sum, 6));
+	sum = vaddq_u16(sum, vextq_u16(zero, sum, 4));
+	offsets = vsubq_u16(sum, total);
+
+	EMIT_LANE_NEON(0);
+	EMIT_LANE_NEON(1);
+	EMIT_LANE_NEON(2);
+	EMIT_LANE_NEON(3);
+	EMIT_LANE_NEON(4);
+	EMIT_LANE_NEON(5);
+	EMIT_LANE_NEON(6);
+	EMIT_LANE_NEON(7);
+
+	return out + vgetq_lane_u16(sum, 7);
+}
+
+int morse_encode_neon(const char* src, int len, char* dst, work_mode mode)
+{
+	u8 normalized[SIMD_BLOCK];
+	u16 entries[SIMD_BLOCK];
+	char* out = dst;
+	uint8x16_t block;
+	int i = 0;
+	int j = 0;
+
+	for (i = 0; i + SIMD_BLOCK <= len; i += SIMD_BLOCK){
+		if (classifyNeon(vld1q_u8((const u8*)(src + i)), &block)){
+			vst1q_u8(normalized, block);
+			for (j = 0; j < SIMD_BLOCK; j++){
+				entries[j] = morse_table[normalized[j]];
+			}
+			out = emitNeon8(out, vld1q_u16(entries), normalized, mode);
+			out = emitNeon8(out, vld1q_u16(entries + 8), normalized + 8, mode);
+		} else{
+			out += morse_encode(src + i, SIMD_BLOCK, out, mode);
+		}
+	}
+
+	/* tail shorter than one block */
+	out += morse_encode(src + i, len - i, out, mode);
+
+	return out - dst;
+}
+
+#endif /* MORSE_SIMD_NEON */
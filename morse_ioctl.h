@@ -0,0 +1,80 @@
+#ifndef MORSE_IOCTL_H
+#define MORSE_IOCTL_H
+
+/* ioctl ABI of /dev/morse_dev<N>, shared by the kernel module (morse_dev.ko) and user space. Bare integer commands 0 - 12 described in morse_main.c are still accepted, everything new is added here only */
+
+#include <linux/ioctl.h>
+#include <linux/types.h>
+
+/* CONSTANTS AND TYPES */
+#define MORSE_UAPI_VERSION 		      5 /* incremented whenever commands or fields are added */
+#define MORSE_IOC_MAGIC 		    0xB7
+#define MORSE_MAX_TEMPLATES 		     32 /* num of templates of each transmitter */
+#define MORSE_PRIORITY_LEVELS 		      4 /* priority classes, 0 -> routine traffic (default) */
+
+/* morse_config.flags: which fields are applied by MORSE_IOC_SET_CONFIG (fields without flag are ignored) */
+#define MORSE_CONFIG_MODE 		(1U << 0)	/* session: work mode of following writes */
+#define MORSE_CONFIG_READ_FORMAT 	(1U << 1)	/* session: format of data returned by read */
+#define MORSE_CONFIG_WEIGHT 		(1U << 2)	/* session: num of messages shown in a row */
+#define MORSE_CONFIG_STREAMING 		(1U << 3)	/* session: streaming mode of write */
+#define MORSE_CONFIG_LED 		(1U << 4)	/* transmitter: LED used by messages which aren't striped */
+#define MORSE_CONFIG_TIME_UNIT 		(1U << 5)	/* transmitter: length of one time unit */
+#define MORSE_CONFIG_LANES 		(1U << 6)	/* transmitter: num of LEDs messages encoded from now on are striped across */
+#define MORSE_CONFIG_TIMER 		(1U << 7)	/* transmitter: timer_hard and timer_cpu */
+#define MORSE_CONFIG_PRIORITY 		(1U << 8)	/* session: priority class of its messages, since version 5 */
+#define MORSE_CONFIG_FIELDS 		(0x1FFU)
+
+/* morse_config.flags: when transmitter fields are applied. LED and time unit are applied at next message boundary (or at once if LED is idle) by default, all other fields at once */
+#define MORSE_CONFIG_NOW 		(1U << 16)	/* apply LED and time unit at once, showing continues from next edge */
+#define MORSE_CONFIG_REPLAY 		(1U << 17)	/* then show message on LED (or last shown one) once again from its beginning */
+#define MORSE_CONFIG_PENDING 		(1U << 24)	/* returned by MORSE_IOC_GET_CONFIG while LED or time unit waits for message boundary */
+
+/* all changes requested by single MORSE_IOC_SET_CONFIG are validated first and applied together (none of them if any is invalid) */
+struct morse_config {
+	__u32 flags;
+	__u32 mode;		/* 0 -> NORMAL, 1 -> ERROR */
+	__u32 read_format;	/* 0 -> '*', '-' and ' ', 1 -> packed */
+	__u32 weight;		/* 1 - 8 */
+	__u32 streaming;	/* 0 or 1 */
+	__u32 led;		/* 0 -> left, 1 -> right */
+	__u64 time_unit_ns;	/* 10 us - 60 s */
+	__u32 lanes;		/* 1 - num of stripe GPIOs of transmitter */
+	__u32 timer_hard;	/* 0 or 1 */
+	__s32 timer_cpu;	/* CPU timer is pinned to, -1 -> any */
+	__u32 priority;		/* 0 - MORSE_PRIORITY_LEVELS - 1, message of higher class suspends one of lower class at next gap between characters. Reserved field (always 0) before version 5 */
+};
+
+/* driver takes struct size from command, so binaries built with older (shorter) or newer (longer, with zeroed unknown tail) struct keep working */
+#define MORSE_IOC_GET_VERSION 		_IOR(MORSE_IOC_MAGIC, 0x00, __u32)
+#define MORSE_IOC_SET_CONFIG 		_IOW(MORSE_IOC_MAGIC, 0x01, struct morse_config)
+#define MORSE_IOC_GET_CONFIG 		_IOR(MORSE_IOC_MAGIC, 0x02, struct morse_config)	/* values which are (or will be at boundary) in effect, flags returns all fields plus MORSE_CONFIG_PENDING */
+
+/* since version 2: time unit in ns (10 us - 60 s) for rate controllers, it takes effect at next LED edge and showing continues where it was. It takes no lock and never stops timer, so it can be called as often as needed */
+#define MORSE_IOC_SET_RATE 		_IOW(MORSE_IOC_MAGIC, 0x03, __u64)
+
+/* morse_beacon.flags */
+#define MORSE_BEACON_GAP 		(1U << 0)	/* period is gap between end of one repeat and start of next one, instead of time between their starts */
+
+/* since version 3: message repeated by driver itself, so beacon needs no user space after setup. Transmitter has at most one beacon, set by any of its sessions and kept after file handle is closed. Repeats take turns with messages of sessions like messages of session of their own, repeat which would start while previous one still waits for LED is skipped */
+struct morse_beacon {
+	__u64 text;		/* user pointer to text of message */
+	__u32 length;		/* num of bytes of text, longer one is truncated as by write. 0 -> stop beacon (repeat already queued is still shown) */
+	__u32 flags;
+	__u64 period_ns;	/* 10 ms - 24 h, at jiffy resolution */
+	__u32 count;		/* num of repeats, 0 -> until stopped */
+	__u32 reserved;		/* has to be 0 */
+};
+
+#define MORSE_IOC_SET_BEACON 		_IOW(MORSE_IOC_MAGIC, 0x04, struct morse_beacon)	/* replaces previous beacon, first repeat is queued at once. Repeats are encoded in work mode of calling session */
+
+/* since version 4: text encoded once and kept by transmitter, so sending it costs neither copying nor encoding. Templates are shared by all sessions of transmitter */
+struct morse_template_def {
+	__u64 text;		/* user pointer to text of message */
+	__u32 length;		/* num of bytes of text, longer one is truncated as by write. 0 -> remove template (messages already queued are still shown) */
+	__u32 id;		/* 0 - MORSE_MAX_TEMPLATES - 1 */
+};
+
+#define MORSE_IOC_SET_TEMPLATE 		_IOW(MORSE_IOC_MAGIC, 0x05, struct morse_template_def)	/* replaces template id, it is encoded in work mode of calling session and with striping in effect */
+#define MORSE_IOC_SEND_TEMPLATE 	_IO(MORSE_IOC_MAGIC, 0x06)	/* arg is template id (not pointer), queued in session as if it was written, incl. blocking while queue is full */
+
+#endif /* MORSE_IOCTL_H */
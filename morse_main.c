@@ -0,0 +1,2738 @@
+#include <linux/module.h>
+#include <linux/atomic.h>
+#include <linux/i2c.h>
+#include <linux/kernel.h>
+#include <linux/fs.h>
+#include <linux/cdev.h>
+#include <linux/compat.h>
+#include <linux/cpumask.h>
+#include <linux/ctype.h>
+#include <linux/debugfs.h>
+#include <linux/device.h>
+#include <linux/io.h>
+#include <linux/ktime.h>
+#include <linux/hrtimer.h>
+#include <linux/idr.h>
+#include <linux/kfifo.h>
+#include <linux/llist.h>
+#include <linux/mm.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/of.h>
+#include <linux/percpu.h>
+#include <linux/platform_device.h>
+#include <linux/poll.h>
+#include <linux/property.h>
+#include <linux/sched.h>
+#include <linux/seq_file.h>
+#include <linux/slab.h>
+#include <linux/smp.h>
+#include <linux/spinlock.h>
+#include <linux/uaccess.h>
+#include <linux/version.h>
+#include <linux/wait.h>
+#include <linux/workqueue.h>
+
+#include "morse_encoder.h"
+#include "morse_ioctl.h"
+#include "morse_output.h"
+#include "morse_shared.h"
+
+#define CREATE_TRACE_POINTS
+#include "morse_trace.h"
+
+/* LIMITS AND EXPECTATIONS */
+/*
+	1. always use echo -n "something" > /dev/morse_dev0 (because we want to avoid sending new line feed) 	
+	2. make only one space between words and no space at the end of word when sending data to driver (i.e. avoid doing this: AB  CD or this: AB CD ). Example of good usage: AB CD
+	3. first echo data to driver (i.e. write data to it) and then perform cat (i.e. reading from it). Each write is one message, messages written while LED is busy wait in queue of file handle they were written through (ioctl cmd 5 and cmd 6 return its depth and capacity through int pointer) and are shown back to back. When queue is full, write sleeps until timer takes next message from it (or fails with EAGAIN if file is opened with O_NONBLOCK). Closing file handle doesn't drop its queued messages
+	4. lowercase letters are folded to capitals, ITU punctuation and prosigns (sent as ASCII control bytes, see morse_encoder.h) are supported, all other bytes are dropped
+	5. In ERROR mode, we will have additional dot and space (i.e. "* ") before each letter
+	6. Time unit is set by ioctl cmd 3 in ms, or by ioctl cmd 9 in ns (arg is pointer to u64), anything from 10 us to 60 s is accepted. Edges shown more than half of unit late are counted in late_edges of mmap-ed status (counter restarts with every change of unit), so short units can be validated on target. Change of time unit or LED through these commands is visible immediately and showing continues where it was (edges from next one on use new unit), MORSE_IOC_SET_CONFIG can also defer it to message boundary or show message once again (see 19), MORSE_IOC_SET_RATE is meant for frequent changes (see 20). Error insertion is done on-fly while encoding, so writing of new portion of data will be needed in order to notice error insertion on diode
+	7. be patient after led shuts off. It doesn't mean that encoded word is ended. There are 3 spaces after last character, during which diode is off, but it is still considered as showing of encoded word
+	8. encoded data is kept packed (2 bits per element or gap, see morse_encoder.h). read returns it rendered as '*', '-' and ' ' by default, ioctl cmd 4 with arg 1 switches read to raw packed bytes (arg 0 switches back)
+	9. poll/select/epoll are supported: POLLOUT is reported while there is space in queue, POLLIN while there is encoded data this file handle didn't read yet. Once newer message is written, next read on same file handle starts from its beginning. Read itself never blocks
+	10. one read-only page can be mmap-ed (offset 0) to observe transmitter state and last written message without syscalls, its layout and reading protocol are described in morse_shared.h
+	11. every open() is separate session with its own work mode (ioctl cmd 0), read format (ioctl cmd 4) and queue. LED is given to sessions with queued messages round-robin (within their priority class, see 25), ioctl cmd 7 sets how many messages in a row session may show (its weight, 1 - QUEUE_CAPACITY, default 1). read returns last message written through same file handle, or last message written by anyone if there is none. LED and time unit are shared by all sessions of same transmitter (see 21)
+	12. ioctl cmd 8 with arg 1 switches session to streaming mode (arg 0 switches back): write appends text of any length to ring buffer of session (STREAM_BUFFER_SIZE bytes, short write when it is full), and it is encoded STREAM_CHUNK characters at a time, just ahead of LED. Each encoded chunk is message of its own (read returns last one), chunks follow each other without any additional gap. Once streamed text gets LED, messages of other sessions of its class or lower wait until its buffer drains (only higher class can interrupt it, see 25), so writer which keeps buffer from running empty gets its whole text shown in one piece
+	13. ioctl cmd 10 stripes following messages across arg LEDs (1 - num of stripe GPIOs of transmitter, default its LEDs): message is split into that many parts of equal num of characters and each part is shown on its own LED at the same time, edges of all LEDs are set and cleared with single register write. arg 1 returns to single LED chosen by ioctl cmd 1. Messages which are already encoded keep their striping
+	14. LEDs are driven through raw BCM2837 GPIO registers by default (output=mmio module parameter, GPIO 32 - 53 only). output=gpiod drives them through gpiolib, GPIO nums are then line offsets of chip named by gpio_chip module parameter (e.g. gpio-sim chip, so driver runs without Raspberry Pi), see morse_output.h
+	15. debugfs directory morse_dev/morse_dev<N> keeps timing of LED edges since load (or since anything is written to its reset file), separately for every timer configuration (see 16): jitter file shows log2 histogram of lateness (actual edge time minus its deadline), min/max/p99 lateness and num of time units edges missed in total for every configuration which was used, edges file shows deadline and actual time of last JITTER_LOG_SIZE edges of current one
+	16. timer expires in softirq on PREEMPT_RT kernels and on any CPU by default. ioctl cmd 11 with arg 1 (or timer_hard module parameter, for all transmitters) makes it expire in hard IRQ context even there (arg 0 switches back), ioctl cmd 12 with arg CPU num (or timer_cpu module parameter) pins it to that CPU, e.g. isolated one (arg -1 unpins it). Change is applied immediately without restarting message on LED, jitter of configurations can be compared through debugfs (see 15)
+	17. counters of write, read, ioctl and timer paths are in /sys/class/morse/morse_dev<N>/stats (summed over all CPUs, since load): writes (successful ones), writes_queued (successful ones while LED was busy, so message waited in queue), writes_rejected (failed ones, incl. EAGAIN), bytes_written, chars_encoded, symbols_encoded, encode_ns (time spent in encoder), reads, bytes_read, ioctls, ioctls_rejected, edges, lit_ns and busy_ns (time LED was on and time messages were shown, both as scheduled), utilization (busy_ns in percent of time since load), preemptions, preempt_ns and preempt_max_ns (num of preemptions, their summed and longest latency, see 25)
+	18. tracepoints of system morse (see morse_trace.h) report every write (accepted or rejected), encoding start and end, queued message, ioctl and LED edge, e.g. perf trace -e 'morse:*' or tracefs events/morse. Edges carry generation of their message, so they can be matched with writes which produced them
+	19. morse_ioctl.h is versioned ioctl ABI: MORSE_IOC_SET_CONFIG sets any combination of options above in single call, all or none of them (invalid value fails whole call with EINVAL). LED and time unit are applied together at next message boundary, or at once with MORSE_CONFIG_NOW, MORSE_CONFIG_REPLAY shows message once again after change. MORSE_IOC_GET_CONFIG returns options in effect. Bare integer commands above are kept for compatibility, each of them is single field applied at once, unknown ones fail with ENOTTY (MORSE_IOC_SET_BEACON and templates, see 23 and 24). All commands work also for 32-bit processes on 64-bit kernel
+	20. MORSE_IOC_SET_RATE changes time unit for rate controllers: new unit is used from next LED edge, message on LED isn't restarted and late_edges isn't reset. Request is only stored for timer, so it can be repeated as often as needed. Last one wins if several come before next edge
+	21. every transmitter is platform device with its own node /dev/morse_dev<N> (N is minor num, in order of probing, at most MORSE_MAX_INSTANCES of them), LEDs, timer, queues, configuration, shared page, statistics and debugfs directory. Transmitters are device tree nodes compatible with "morse,transmitter" whose morse,led-gpios property holds GPIO of left LED and optionally of right one (single LED is used by both ioctl cmd 1 values) and optional morse,stripe-gpios property holds stripe GPIOs. Without such nodes they are created from module parameters: left_gpios=35,36,... creates one transmitter per GPIO, right_gpios gives their right LEDs (default 47 for first one, -1 -> single LED) and stripe_gpios belongs to first one. Backend is same for all of them (see 14), each GPIO can be used by single transmitter
+	22. transmitters don't have timers of their own: all transmitters with same timer configuration (see 16) share single high resolution timer, one per CPU they are pinned to and one unpinned, which keeps deadlines of their next edges in min-heap and expires only at earliest of them. Edges due within coalesce_ns module parameter (default 1000 ns) after it are shown by same interrupt, each of them at most that much early (jitter statistics count early edges as on time). With mmio output their GPIOs are switched by single GPSET1 and single GPCLR1 write, so transmitters whose edges coincide have no skew between them
+	23. MORSE_IOC_SET_BEACON makes driver repeat message by itself, every period_ns (counted from start of previous repeat, or from its end with MORSE_BEACON_GAP), count times or until stopped, so beacon node needs no user space after setup. Each repeat is encoded and queued as if it was written by session of its own (read and mmap-ed stream show it as last written message, writes counters don't count it), next one is queued by delayed work at jiffy resolution on power efficient workqueue. Transmitter has single beacon which survives closing of file handle that set it and is stopped by length 0 or by module unload
+	24. MORSE_IOC_SET_TEMPLATE encodes text once into numbered template of transmitter (MORSE_MAX_TEMPLATES of them, shared by its sessions), MORSE_IOC_SEND_TEMPLATE with template id as arg queues message which points to its encoding, so sending fixed vocabulary costs neither copy from user nor encoding. Such message behaves as written one (generation, read, mmap-ed stream, blocking on full queue), except that writes counters don't count it. Template keeps work mode and striping it was encoded with, replaced or removed one lives until last message using it is released
+	25. MORSE_CONFIG_PRIORITY sets priority class of session (0 - MORSE_PRIORITY_LEVELS - 1, default 0, beacon is always 0). Scheduler takes messages of highest class first, and message of higher class suspends message on LED at its next gap between characters (or words): it is shown right after gap, then suspended message continues with its next character, it isn't restarted. So preemption latency is bounded by longest character plus gap after it, or by whole message for striped messages whose lanes have no common gap. Latency is counted from moment preempting message was staged to its first edge, num of preemptions, sum and max of latencies are in stats (see 17), every preemption is also traced (morse_preempt)
+*/
+
+/* CONSTANTS AND TYPES */
+#define MORSE_MAX_INSTANCES 		     16	/* num of minor numbers, i.e. max num of transmitters */
+#define ENCODED_DATA_SIZE 		MORSE_STREAM_SIZE
+#define RENDER_CHUNK 			     64 /* num of symbols rendered to ASCII on stack before being copied to user */
+#define QUEUE_CAPACITY 			      8 /* max num of encoded messages waiting for LED per session (has to be power of 2, because of kfifo) */
+#define MESSAGES_PER_SESSION 		(QUEUE_CAPACITY + 6) /* queued ones, staged one, one on LED, retired one, last written one kept for read (per session and global) and spare one for readers holding replaced message */
+#define MAX_NUM_OF_RUNS 		(MAX_NUM_OF_CHARS_TO_BE_ENCODED * ENCODED_CHAR_MAX_LENGTH)
+#define STREAM_BUFFER_SIZE 		   4096 /* raw text waiting for encoding in streaming mode (has to be power of 2, because of kfifo) */
+#define STREAM_CHUNK 			      8 /* num of characters encoded at once in streaming mode, first LED edge never waits for more than this */
+#define STREAM_LOOKAHEAD 		      2 /* num of encoded chunks kept ready in queue in streaming mode */
+#define MIN_TIME_UNIT_NS 		(10ULL * NSEC_PER_USEC) /* shortest time unit, bellow it timer interrupt overhead eats significant part of unit */
+#define MAX_TIME_UNIT_NS 		(60ULL * NSEC_PER_SEC)
+#define CHAR_GAP_UNITS 			      3 /* shortest gap between characters, gaps between elements of character are single unit */
+#define MIN_BEACON_PERIOD_NS 		(10ULL * NSEC_PER_MSEC) /* beacon is rearmed by delayed work, i.e. at jiffy resolution */
+#define MAX_BEACON_PERIOD_NS 		(24ULL * 3600 * NSEC_PER_SEC)
+
+#define JITTER_BUCKETS 			     32 /* lateness histogram, bucket 0 -> on time, bucket i -> [2^(i-1), 2^i) ns, last one collects everything above */
+#define JITTER_LOG_SIZE 		     64 /* num of last edges kept with their deadline and actual time */
+#define TIMER_CONFIGS 			      4 /* [hard IRQ expiry * 2 + pinned], see timerConfig() */
+#define DEFAULT_TIME_UNIT_NS 		(2000ULL * NSEC_PER_MSEC)
+#define DRIVER_NAME 			"morse_dev"	/* platform driver, also name of platform devices created from module parameters */
+#define OF_COMPATIBLE 			"morse,transmitter"
+#define PROP_LED_GPIOS 			"morse,led-gpios"	/* device property: GPIO num of left LED and optionally of right one */
+#define PROP_STRIPE_GPIOS 		"morse,stripe-gpios"	/* device property: GPIOs messages can be striped across, in lane order (default LEDs) */
+
+typedef enum {
+	LED_LEFT,
+	LED_RIGHT
+} led_selector;
+
+typedef enum {
+	READ_ASCII,	/* '*', '-' and ' ', one byte per symbol */
+	READ_PACKED	/* raw internal representation, 4 symbols per byte (see morse_encoder.h) */
+} read_format;
+
+typedef struct morse_session morse_session;
+typedef struct morse_transmitter morse_transmitter;
+
+/* driver counters, every CPU has its own copy (see sumStats()) */
+typedef struct {
+	u64 writes;
+	u64 writes_queued;
+	u64 writes_rejected;
+	u64 bytes_written;
+	u64 chars_encoded;
+	u64 symbols_encoded;
+	u64 encode_ns;
+	u64 reads;
+	u64 bytes_read;
+	u64 ioctls;
+	u64 ioctls_rejected;
+	u64 edges;
+	u64 lit_ns;
+	u64 busy_ns;
+	u64 preemptions;
+	u64 preempt_ns;
+} morse_stats;
+
+/* LED edge as seen by timer */
+typedef struct {
+	ktime_t scheduled;
+	ktime_t actual;				/* right after output was driven */
+} morse_edge;
+
+/* timing of LED edges, exposed through debugfs */
+typedef struct {
+	u64 edges;
+	u64 missed_units;			/* sum of whole time units edges were late by */
+	u64 min_late_ns;
+	u64 max_late_ns;
+	u64 buckets[JITTER_BUCKETS];
+	morse_edge log[JITTER_LOG_SIZE];	/* last edges, edges % JITTER_LOG_SIZE is next one to be overwritten */
+} morse_jitter;
+
+/* encoded form of text, never changed once message using it is queued */
+typedef struct {
+	u8 encodedData[ENCODED_DATA_SIZE];	/* packed symbols */
+	int encodedDataLength;			/* num of symbols in encodedData */
+	morse_run schedule[MAX_NUM_OF_RUNS];	/* LED edge schedule of encodedData, precomputed on write */
+	int scheduleLength;
+	work_mode mode;				/* mode it was encoded in */
+	int lanes;				/* num of LEDs schedule is striped across, 1 -> selected_led */
+} morse_encoding;
+
+/* text encoded once by MORSE_IOC_SET_TEMPLATE, shared by all messages sending it */
+typedef struct {
+	morse_encoding encoding;
+	int refs;				/* registry of transmitter plus messages using it, freed when it drops to zero, changed only under tx_lock */
+	struct rcu_head rcu;			/* last reference is dropped under tx_lock, so freeing is deferred as for session */
+} morse_template;
+
+/* single written portion of data, encoded and ready for LED */
+typedef struct {
+	const morse_encoding* encoding;		/* own one, or one of template */
+	morse_encoding own;
+	morse_template* template;		/* template whose encoding is used (NULL -> own one), kept while message has refs */
+	u32 generation;				/* sequence num of write which produced message, used by readers to detect new output */
+	int priority;				/* class of session it was taken from by scheduler */
+	ktime_t staged_at;			/* when it was put to stage, start of preemption latency */
+	int resume_run;				/* cursor it was suspended at (0 -> its beginning), it continues from there once it gets LED again */
+	u32 resume_units;
+	struct list_head suspended;		/* in suspended_messages while it waits for LED again */
+	struct llist_node preempted;		/* in preempted_messages after timer suspended it */
+	int refs;				/* queue/stage/LED, session's and global last written, readers. Back to free_messages of its session when it drops to zero, changed only under tx_lock */
+	morse_session* session;
+	struct llist_node retired;		/* in retired_messages after timer moved to next message */
+} morse_message;
+
+/* state of single open() of device */
+struct morse_session {
+	morse_transmitter* tx;			/* transmitter of device node session was opened on */
+	work_mode mode;
+	read_format format;
+	int streaming;				/* write appends to stream_data instead of writing single message */
+	int weight;				/* num of messages shown in a row before LED is given to next session */
+	int burst;				/* num of messages shown in a row so far */
+	int priority;				/* class of its messages, 0 - MORSE_PRIORITY_LEVELS - 1 */
+	int messages_being_encoded;		/* taken from free_messages, not yet in pending_messages */
+	int users;				/* file handle, messages with refs and stream_session of transmitter, session is freed when it drops to zero, changed only under tx_lock */
+	morse_message* latest_message;		/* last one written through this session */
+	u32 read_generation;			/* generation of message read through this session */
+	struct list_head ready;			/* in ready_sessions of its priority while pending_messages isn't empty */
+	DECLARE_KFIFO(pending_messages, morse_message*, QUEUE_CAPACITY);	/* encoded, waiting for LED */
+	DECLARE_KFIFO(free_messages, morse_message*, 2 * QUEUE_CAPACITY);	/* available for encoding */
+	DECLARE_KFIFO(stream_data, char, STREAM_BUFFER_SIZE);			/* raw text not encoded yet, consumed only with tx_mutex held */
+	struct mutex stream_mutex;		/* serializes writers of stream_data */
+	struct rcu_head rcu;			/* last user is dropped under tx_lock, and vfree of big session can sleep, so freeing is deferred */
+	morse_message messages[MESSAGES_PER_SESSION];
+};
+
+/* LED edge of single transmitter within batch of edges shown by one timer interrupt */
+typedef struct {
+	morse_transmitter* tx;
+	ktime_t scheduled;
+	ktime_t next;				/* deadline of following edge, KTIME_MAX -> transmitter stopped */
+	u32 generation;
+	int run;
+	u32 led_on;
+} morse_batch_edge;
+
+/* shared timer of all transmitters with same timer configuration (hard IRQ expiry and CPU), one per CPU and one unpinned. Its heap holds next edge deadlines of transmitters, edges due together are shown by single interrupt */
+typedef struct {
+	struct hrtimer timer;
+	enum hrtimer_mode mode;
+	int cpu;				/* CPU timer is pinned to, -1 -> any */
+	raw_spinlock_t lock;			/* held by timer while it shows edges, so transmitter taken from heap under it is never in the middle of edge. Taken also in hard IRQ context, so process context takes it with interrupts disabled */
+	ktime_t expires;			/* deadline timer is programmed for, KTIME_MAX -> idle */
+	morse_transmitter* heap[MORSE_MAX_INSTANCES];	/* min-heap by deadline, heap[0] is due first */
+	int heap_size;
+	morse_batch_edge batch[MORSE_MAX_INSTANCES];	/* edges shown by current interrupt */
+	morse_output_edge edges[MORSE_MAX_INSTANCES];	/* their output words */
+} morse_scheduler;
+
+/* single LED transmitter with its own device node, LEDs, timer, queues and configuration. Created by probe of platform device, lives until module is unloaded */
+struct morse_transmitter {
+	int id;					/* minor num, node is /dev/morse_dev<id> */
+	struct cdev cdev;
+	struct device* device;			/* carries sysfs statistics */
+	
+	/* LEDs */
+	void* output_data;			/* instance data of output backend */
+	led_selector selected_led;		/* LED of messages which aren't striped, in effect */
+	u32 led_gpio_bits[2];			/* [led_selector] -> output word of LED */
+	int stripe_lanes;			/* num of LEDs messages are striped across when they are encoded, 1 -> selected_led only */
+	u32 lane_gpio_bits[1 << MORSE_MAX_LANES];	/* [led_on of run of striped message] -> output word of LEDs which are on */
+	u32 all_gpio_bits;			/* output word of all LEDs */
+	int config_pending;			/* pending_led and pending_time_unit_ns wait for message boundary. Changed only by timer or while it is cancelled */
+	led_selector pending_led;
+	u64 pending_time_unit_ns;
+	atomic64_t live_time_unit_ns;		/* unit requested by MORSE_IOC_SET_RATE, taken by timer at next edge (0 -> none) */
+	int led_gpios[2];			/* [led_selector] -> GPIO, both are same GPIO if instance has single LED */
+	int stripe_gpios[MORSE_MAX_LANES];
+	int num_of_stripe_gpios;
+	int output_gpios[MORSE_MAX_OUTPUTS];	/* both LEDs and stripe GPIOs, claimed by output */
+	int num_of_output_gpios;
+	int run_to_be_shown;			/* index of next run in schedule of shown message */
+	int blinking;				/* set while timer is showing messages, cleared only by timer when there is nothing staged (see showEdge() and stageNext()) */
+	
+	/* timer */
+	u64 time_unit_ns;
+	u32 late_edges;				/* num of edges shown more than half of time unit after their deadline */
+	morse_scheduler* sched;			/* shared timer of timer configuration, chosen by timerConfig() while transmitter isn't queued */
+	ktime_t deadline;			/* of next edge, valid while transmitter is queued in sched */
+	int heap_index;				/* position in heap of sched, -1 -> not queued (nothing to show, or being reconfigured) */
+	ktime_t message_start;			/* all edge deadlines are absolute, relative to this moment, so callback latency never accumulates */
+	u32 elapsed_units;			/* units from message start to start of run_to_be_shown */
+	bool timer_hard;			/* expire in hard IRQ context also on PREEMPT_RT */
+	int timer_cpu;				/* CPU timer is pinned to, -1 -> any */
+	int timer_config;			/* index of jitter statistics of current configuration */
+	morse_jitter jitter[TIMER_CONFIGS];	/* written by timer, protected by jitter_lock */
+	raw_spinlock_t jitter_lock;		/* taken by timer (also in hard IRQ context on PREEMPT_RT), so process context takes it with interrupts disabled */
+	struct dentry* debugfs_dir;
+	morse_stats __percpu* stats;		/* updated with this_cpu_*() by every path, so they never share cache line or lock */
+	u64 load_time_ns;			/* start of utilization period */
+	
+	/* messages */
+	struct list_head ready_sessions[MORSE_PRIORITY_LEVELS];	/* sessions with queued messages, by priority class, in order they get LED */
+	struct list_head suspended_messages;	/* preempted ones and ones taken back from stage for higher class, last suspended first. They hold their queue/stage/LED reference */
+	struct llist_head preempted_messages;	/* suspended by timer, moved to suspended_messages by nextMessage() */
+	u64 preempt_max_ns;			/* longest preemption latency since load, written only by timer */
+	morse_session* stream_session;		/* streaming session which keeps LED from other sessions of its class until its text drains, holds one of its users. Changed only under tx_lock */
+	morse_message* shown_message;		/* front buffer: on LED, or last one shown (kept for replay after configuration change). Owned by timer while it runs */
+	morse_message* staged_message;		/* back buffer: next one for LED, filled by process context, taken by timer with xchg() at message boundary */
+	struct llist_head retired_messages;	/* front buffers timer moved away from, released by stage_work */
+	morse_message* latest_message;		/* last one written by any session, returned by read of sessions which didn't write anything */
+	u32 messages_written;			/* num of successful writes, source of message generation */
+	wait_queue_head_t write_wait;		/* writers (and pollers) waiting for space in queue */
+	wait_queue_head_t read_wait;		/* readers (pollers) waiting for new encoded output */
+	morse_shared_page* shared_page;		/* mmap-ed by monitoring tools (see morse_shared.h) */
+	spinlock_t tx_lock;			/* protects session queues and message references, never taken by timer */
+	struct mutex tx_mutex;			/* serializes process context paths which start or cancel timer or fill stage */
+	int removing;				/* set by remove under tx_mutex, stageNext() doesn't start timer any more */
+	struct work_struct stage_work;		/* refills stage and releases retired messages after timer flipped buffers */
+	
+	/* beacon, changed only under tx_mutex */
+	morse_session* beacon;			/* session of its own repeats are queued in, NULL -> no beacon. Read also by timer */
+	char beacon_text[MAX_NUM_OF_CHARS_TO_BE_ENCODED];
+	int beacon_length;
+	u32 beacon_flags;
+	u64 beacon_period_ns;
+	u32 beacon_count;			/* num of repeats, 0 -> until stopped */
+	u32 beacon_repeats;			/* num of repeats queued so far */
+	ktime_t beacon_next;			/* when next repeat is due, unless MORSE_BEACON_GAP is set */
+	struct delayed_work beacon_work;	/* queues next repeat, rearmed by itself, or by timer at end of repeat with MORSE_BEACON_GAP */
+	
+	morse_template* templates[MORSE_MAX_TEMPLATES];	/* registry of MORSE_IOC_SET_TEMPLATE, changed only under tx_lock */
+};
+
+/* HW RELATED DATA */
+
+/* devices */
+dev_t dev;					/* first of MORSE_MAX_INSTANCES minors */
+struct class* morse_class = NULL;
+DEFINE_IDA(morse_ida);				/* minors of probed transmitters */
+struct platform_device* param_devices[MORSE_MAX_INSTANCES];	/* transmitters described by module parameters (if there is none in device tree) */
+int num_of_param_devices = 0;
+struct dentry* debugfs_root = NULL;
+
+/* LEDs, module parameters describe transmitters which aren't in device tree */
+static char* output_name = "mmio";
+module_param_named(output, output_name, charp, 0444);
+MODULE_PARM_DESC(output, "LED output backend of all transmitters: mmio (BCM2837 registers) or gpiod (gpiolib)");
+const morse_output* output = NULL;
+static int left_gpios[MORSE_MAX_INSTANCES] = { 35 };
+static int num_of_left_gpios = 1;
+module_param_array(left_gpios, int, &num_of_left_gpios, 0444);
+MODULE_PARM_DESC(left_gpios, "Left LED of every transmitter, one transmitter per GPIO");
+static int right_gpios[MORSE_MAX_INSTANCES] = { 47 };
+static int num_of_right_gpios = 1;
+module_param_array(right_gpios, int, &num_of_right_gpios, 0444);
+MODULE_PARM_DESC(right_gpios, "Right LED of every transmitter, missing or -1 -> transmitter has single LED");
+static int stripe_gpios[MORSE_MAX_LANES];
+static int num_of_stripe_gpios = 0;
+module_param_array(stripe_gpios, int, &num_of_stripe_gpios, 0444);
+MODULE_PARM_DESC(stripe_gpios, "GPIOs messages of transmitter 0 can be striped across, in lane order (default its LEDs, other transmitters always use their LEDs)");
+
+/* timer */
+static bool timer_hard = false;
+module_param(timer_hard, bool, 0444);
+MODULE_PARM_DESC(timer_hard, "Initial timer expiry in hard IRQ context of all transmitters (changed by ioctl cmd 11)");
+static int timer_cpu = -1;
+module_param(timer_cpu, int, 0444);
+MODULE_PARM_DESC(timer_cpu, "Initial CPU timers of all transmitters are pinned to, -1 for any (changed by ioctl cmd 12)");
+static unsigned int coalesce_ns = 1000;
+module_param(coalesce_ns, uint, 0444);
+MODULE_PARM_DESC(coalesce_ns, "Edges of transmitters sharing timer which are due within this window are shown together, each of them at most this much early");
+morse_scheduler unpinned_schedulers[2];		/* [timer_hard] */
+DEFINE_PER_CPU(morse_scheduler, pinned_schedulers[2]);	/* [timer_hard] of every CPU */
+
+/* DEVICE FUNCTIONS PROTOTYPES */
+static int morse_open(struct inode *inode, struct file *file);
+static int morse_release(struct inode *inode, struct file *file);
+static ssize_t morse_read(struct file *file, char __user *buf, size_t count, loff_t *ppos);
+static ssize_t morse_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos);
+static long morse_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
+#ifdef CONFIG_COMPAT
+static long morse_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg);
+#endif
+static __poll_t morse_poll(struct file *file, poll_table *wait);
+static int morse_mmap(struct file *file, struct vm_area_struct *vma);
+static void startTransmission(morse_transmitter* tx, morse_message* message);
+static void stageWorkHandler(struct work_struct* work);
+static void beaconWorkHandler(struct work_struct* work);
+static void closeSession(morse_session* session);
+static void refillStream(morse_session* session);
+
+/* output words which set all LEDs at once, led_on is led_on of run of message (bit i -> lane i if it is striped) */
+static inline void runEdge(morse_transmitter* tx, const morse_message* message, u32 led_on, morse_output_edge* edge)
+{
+	u32 on = (message->encoding->lanes == 1) ? (led_on ? tx->led_gpio_bits[tx->selected_led] : 0) : tx->lane_gpio_bits[led_on];
+	
+	edge->data = tx->output_data;
+	edge->set = on;
+	edge->clear = tx->all_gpio_bits & ~on;
+}
+
+static inline void offEdge(morse_transmitter* tx, morse_output_edge* edge)
+{
+	edge->data = tx->output_data;
+	edge->set = 0;
+	edge->clear = tx->all_gpio_bits;
+}
+
+static inline void driveRun(morse_transmitter* tx, const morse_message* message, u32 led_on)
+{
+	morse_output_edge edge;
+	
+	runEdge(tx, message, led_on, &edge);
+	output->drive(edge.data, edge.set, edge.clear);
+}
+
+static inline void driveOff(morse_transmitter* tx)
+{
+	output->drive(tx->output_data, 0, tx->all_gpio_bits);
+}
+
+/* builds output words of LEDs and of all combinations of stripe lanes, called once output is set up */
+static void mapOutputs(morse_transmitter* tx)
+{
+	u32 mask;
+	int i = 0;
+	
+	tx->led_gpio_bits[LED_LEFT] = output->gpioBit(tx->output_data, tx->led_gpios[LED_LEFT]);
+	tx->led_gpio_bits[LED_RIGHT] = output->gpioBit(tx->output_data, tx->led_gpios[LED_RIGHT]);
+	tx->all_gpio_bits = tx->led_gpio_bits[LED_LEFT] | tx->led_gpio_bits[LED_RIGHT];
+	
+	for (mask = 0; mask < ARRAY_SIZE(tx->lane_gpio_bits); mask++){
+		tx->lane_gpio_bits[mask] = 0;
+		for (i = 0; i < tx->num_of_stripe_gpios; i++){
+			if (mask & (1 << i)){
+				tx->lane_gpio_bits[mask] |= output->gpioBit(tx->output_data, tx->stripe_gpios[i]);
+			}
+		}
+	}
+	tx->all_gpio_bits |= tx->lane_gpio_bits[(1 << tx->num_of_stripe_gpios) - 1];
+}
+
+/* applies time unit requested by MORSE_IOC_SET_RATE, edges from next_edge on use it. Called by timer or while it is cancelled */
+static void applyLiveRate(morse_transmitter* tx, ktime_t next_edge)
+{
+	u64 unit_ns = atomic64_xchg(&tx->live_time_unit_ns, 0);
+	
+	if (unit_ns == 0){
+		return;
+	}
+	
+	/* it overrides unit waiting for boundary too */
+	tx->time_unit_ns = unit_ns;
+	tx->pending_time_unit_ns = unit_ns;
+	tx->message_start = ktime_sub_ns(next_edge, tx->elapsed_units * tx->time_unit_ns);
+}
+
+/* applies LED and time unit which wait for message boundary, edges from next_edge on use new time unit. Called by timer or while it is cancelled */
+static void applyPendingConfig(morse_transmitter* tx, ktime_t next_edge)
+{
+	if (!tx->config_pending){
+		return;
+	}
+	
+	tx->selected_led = tx->pending_led;
+	if (tx->pending_time_unit_ns != tx->time_unit_ns){
+		tx->time_unit_ns = tx->pending_time_unit_ns;
+		tx->late_edges = 0;
+	}
+	tx->message_start = ktime_sub_ns(next_edge, tx->elapsed_units * tx->time_unit_ns);
+	tx->config_pending = 0;
+}
+
+/* shared page writer side of sequence protocol, block is consistent only while sequence is even */
+static inline void sharedWriteBegin(u32* sequence)
+{
+	WRITE_ONCE(*sequence, *sequence + 1);
+	smp_wmb();
+}
+
+static inline void sharedWriteEnd(u32* sequence)
+{
+	smp_wmb();
+	WRITE_ONCE(*sequence, *sequence + 1);
+}
+
+/* Called only by timer callback or while timer is cancelled, so status block always has single writer */
+static void publishStatus(morse_transmitter* tx, int active)
+{
+	morse_status* status = &tx->shared_page->status;
+	
+	sharedWriteBegin(&status->sequence);
+	status->active = active;
+	if (tx->shown_message != NULL){
+		status->generation = tx->shown_message->generation;
+		status->length = tx->shown_message->encoding->encodedDataLength;
+		status->runs = tx->shown_message->encoding->scheduleLength;
+		status->mode = tx->shown_message->encoding->mode;
+	}
+	status->run = tx->run_to_be_shown;
+	status->elapsed_units = tx->elapsed_units;
+	status->led = tx->selected_led;
+	status->lanes = tx->stripe_lanes;
+	status->late_edges = tx->late_edges;
+	status->time_unit_ns = tx->time_unit_ns;
+	sharedWriteEnd(&status->sequence);
+}
+
+/* Called with tx_mutex held, so stream block always has single writer */
+static void publishStream(morse_transmitter* tx, const morse_message* message)
+{
+	morse_stream* stream = &tx->shared_page->stream;
+	
+	sharedWriteBegin(&stream->sequence);
+	stream->generation = message->generation;
+	stream->length = message->encoding->encodedDataLength;
+	memcpy(stream->data, message->encoding->encodedData, MORSE_PACKED_SIZE(message->encoding->encodedDataLength));
+	sharedWriteEnd(&stream->sequence);
+}
+
+/* Called with tx_lock held */
+static void putSession(morse_session* session)
+{
+	if (--session->users == 0){
+		kvfree_rcu(session, rcu);
+	}
+}
+
+/* Called with tx_lock held */
+static void putTemplate(morse_template* template)
+{
+	if (--template->refs == 0){
+		kvfree_rcu(template, rcu);
+	}
+}
+
+/* Called with tx_lock held */
+static void getMessage(morse_message* message)
+{
+	if (message->refs++ == 0){
+		message->session->users++;
+	}
+}
+
+/* Called with tx_lock held, returns 1 if message became free */
+static int putMessage(morse_message* message)
+{
+	morse_session* session = message->session;
+	
+	if (--message->refs == 0){
+		if (message->template != NULL){
+			putTemplate(message->template);
+			message->template = NULL;
+		}
+		kfifo_put(&session->free_messages, message);
+		putSession(session);
+		
+		return 1;
+	}
+	
+	return 0;
+}
+
+/* highest priority class with queued messages, -1 if there is none. Called with tx_lock held */
+static int readyPriority(morse_transmitter* tx)
+{
+	int priority = 0;
+	
+	for (priority = MORSE_PRIORITY_LEVELS - 1; priority >= 0; priority--){
+		if (!list_empty(&tx->ready_sessions[priority])){
+			return priority;
+		}
+	}
+	
+	return -1;
+}
+
+/* Scheduler: suspended message continues before queued ones of its class or lower. Otherwise it is round-robin within highest class with queued messages: next message of session at head of ready_sessions is taken, session goes to tail once it showed weight messages in a row. Streaming session is exception, once it gets LED its chunks follow each other until its text drains, so other sessions of its class never split streamed text. Called with tx_lock held */
+static morse_message* nextMessage(morse_transmitter* tx)
+{
+	struct llist_node* preempted;
+	morse_session* session;
+	morse_message* message = NULL;
+	morse_message* tmp;
+	int priority;
+	
+	/* timer suspends message only while it has higher one staged, so they are moved here before stage is filled again */
+	preempted = llist_reverse_order(llist_del_all(&tx->preempted_messages));
+	llist_for_each_entry_safe(message, tmp, preempted, preempted){
+		list_add(&message->suspended, &tx->suspended_messages);
+	}
+	
+	priority = readyPriority(tx);
+	message = list_first_entry_or_null(&tx->suspended_messages, morse_message, suspended);
+	if (message != NULL && message->priority >= priority){
+		list_del(&message->suspended);
+		return message;
+	}
+	if (priority < 0){
+		return NULL;
+	}
+	
+	session = tx->stream_session;
+	if (session == NULL || session->priority < priority || kfifo_is_empty(&session->pending_messages)){
+		session = list_first_entry(&tx->ready_sessions[priority], morse_session, ready);
+	}
+	if (!kfifo_get(&session->pending_messages, &message)){
+		/* should not happen */
+	}
+	message->priority = priority;
+	message->resume_run = 0;
+	message->resume_units = 0;
+	
+	if (kfifo_is_empty(&session->pending_messages)){
+		list_del_init(&session->ready);
+		session->burst = 0;
+	} else{
+		if (session != tx->stream_session && ++session->burst >= session->weight){
+			list_move_tail(&session->ready, &tx->ready_sessions[priority]);
+			session->burst = 0;
+		}
+	}
+	
+	/* next chunk is queued by refillStream() before scheduler runs again, text is drained once nothing waits in buffer and queue */
+	if (tx->stream_session == NULL && session->streaming && !(kfifo_is_empty(&session->stream_data) && kfifo_is_empty(&session->pending_messages))){
+		session->users++;
+		tx->stream_session = session;
+	}
+	if (tx->stream_session == session && kfifo_is_empty(&session->stream_data) && kfifo_is_empty(&session->pending_messages)){
+		tx->stream_session = NULL;
+		putSession(session);
+	}
+	
+	return message;
+}
+
+/* Called by timer after every LED edge */
+static void recordEdge(morse_transmitter* tx, ktime_t scheduled, ktime_t actual)
+{
+	s64 late_ns = ktime_to_ns(ktime_sub(actual, scheduled));
+	u64 late = (late_ns > 0) ? late_ns : 0;
+	
+	morse_jitter* stats = &tx->jitter[tx->timer_config];
+	
+	raw_spin_lock(&tx->jitter_lock);
+	
+	stats->log[stats->edges % JITTER_LOG_SIZE].scheduled = scheduled;
+	stats->log[stats->edges % JITTER_LOG_SIZE].actual = actual;
+	if (stats->edges == 0 || late < stats->min_late_ns){
+		stats->min_late_ns = late;
+	}
+	if (late > stats->max_late_ns){
+		stats->max_late_ns = late;
+	}
+	stats->buckets[min(fls64(late), JITTER_BUCKETS - 1)]++;
+	stats->missed_units += div64_u64(late, tx->time_unit_ns);
+	stats->edges++;
+	
+	raw_spin_unlock(&tx->jitter_lock);
+}
+
+/* edge after gap between characters (or words) of shown message, all its LEDs are off there, so it can be left and continued later without any character being changed. Gaps of striped message are those of all lanes together */
+static inline int atCharacterGap(morse_transmitter* tx)
+{
+	const morse_encoding* encoding = tx->shown_message->encoding;
+	int run = tx->run_to_be_shown;
+	
+	return run > 0 && run < encoding->scheduleLength && !encoding->schedule[run - 1].led_on && encoding->schedule[run - 1].units >= CHAR_GAP_UNITS;
+}
+
+/* message taken from stage is shown from edge at start on, from its beginning or from cursor it was suspended at. Called by timer */
+static void switchMessage(morse_transmitter* tx, morse_message* message, ktime_t start)
+{
+	tx->shown_message = message;
+	tx->run_to_be_shown = message->resume_run;
+	tx->elapsed_units = message->resume_units;
+	message->resume_run = 0;
+	message->resume_units = 0;
+	schedule_work(&tx->stage_work);
+	
+	/* deadlines stay relative to message start, as if message was never suspended */
+	tx->message_start = ktime_sub_ns(start, (u64)tx->elapsed_units * tx->time_unit_ns);
+	applyPendingConfig(tx, start);
+}
+
+/* suspends shown message at character gap in favour of staged message of higher class. Called by timer */
+static void preemptMessage(morse_transmitter* tx, morse_message* next, ktime_t scheduled)
+{
+	morse_message* suspended = tx->shown_message;
+	s64 latency_ns = ktime_to_ns(ktime_sub(scheduled, next->staged_at));
+	u64 latency = (latency_ns > 0) ? latency_ns : 0;
+	
+	suspended->resume_run = tx->run_to_be_shown;
+	suspended->resume_units = tx->elapsed_units;
+	llist_add(&suspended->preempted, &tx->preempted_messages);
+	
+	trace_morse_preempt(tx->id, suspended->generation, tx->run_to_be_shown, next->generation, latency);
+	this_cpu_inc(tx->stats->preemptions);
+	this_cpu_add(tx->stats->preempt_ns, latency);
+	if (latency > tx->preempt_max_ns){
+		WRITE_ONCE(tx->preempt_max_ns, latency);
+	}
+	
+	switchMessage(tx, next, ktime_add_ns(tx->message_start, (u64)tx->elapsed_units * tx->time_unit_ns));
+}
+
+/* shows edge of transmitter which is due, returns deadline of its following edge or KTIME_MAX if it has nothing more to show. Called by scheduler of transmitter with its lock held, output word of edge is stored to out and driven together with other edges of batch */
+static ktime_t showEdge(morse_transmitter* tx, morse_batch_edge* edge, ktime_t now, morse_output_edge* out)
+{
+	const morse_run* run;
+	morse_message* next = NULL;
+	morse_message* staged;
+	ktime_t scheduled = edge->scheduled;
+	
+	/* at short time units interrupt latency becomes comparable to unit, such edges are counted so high-speed link can be validated */
+	if (ktime_to_ns(ktime_sub(now, scheduled)) > (s64)(tx->time_unit_ns >> 1)){
+		tx->late_edges++;
+	}
+	
+	/* this edge keeps its deadline, following ones use unit requested by MORSE_IOC_SET_RATE */
+	if (atomic64_read(&tx->live_time_unit_ns) != 0){
+		applyLiveRate(tx, scheduled);
+	}
+	
+	if (tx->run_to_be_shown == tx->shown_message->encoding->scheduleLength){
+		/* shown message keeps its session alive, so session of beacon which was replaced meanwhile never matches */
+		if (tx->shown_message->session == READ_ONCE(tx->beacon) && (READ_ONCE(tx->beacon_flags) & MORSE_BEACON_GAP)){
+			queue_delayed_work(system_power_efficient_wq, &tx->beacon_work, nsecs_to_jiffies(READ_ONCE(tx->beacon_period_ns)));
+		}
+		
+		/* end of last run, i.e. of whole message. Flip to staged one, or stop until next write if there is none. No lock of transmitter is taken here, writers only ever fill stage */
+		next = xchg(&tx->staged_message, NULL);
+		if (next == NULL){
+			/* stageNext() stores stage before it checks blinking, so either it sees timer stopped or timer sees its message */
+			WRITE_ONCE(tx->blinking, 0);
+			smp_mb();
+			next = xchg(&tx->staged_message, NULL);
+			if (next == NULL){
+				offEdge(tx, out);
+				applyPendingConfig(tx, scheduled);
+				edge->generation = tx->shown_message->generation;
+				edge->run = tx->run_to_be_shown;
+				edge->led_on = 0;
+				publishStatus(tx, 0);
+				
+				return KTIME_MAX;
+			}
+			WRITE_ONCE(tx->blinking, 1);
+		}
+		
+		llist_add(&tx->shown_message->retired, &tx->retired_messages);
+		
+		/* next message starts exactly where previous one ended, so LED is never idle between them */
+		switchMessage(tx, next, ktime_add_ns(tx->message_start, tx->elapsed_units * tx->time_unit_ns));
+	} else{
+		/* stage is only ever refilled with message of same or higher class than one taken back from it, so message taken here outranks shown one as well */
+		staged = READ_ONCE(tx->staged_message);
+		if (staged != NULL && staged->priority > tx->shown_message->priority && atCharacterGap(tx)){
+			next = xchg(&tx->staged_message, NULL);
+			if (next != NULL){
+				preemptMessage(tx, next, scheduled);
+			}
+		}
+	}
+	
+	run = &tx->shown_message->encoding->schedule[tx->run_to_be_shown];
+	runEdge(tx, tx->shown_message, run->led_on, out);
+	edge->generation = tx->shown_message->generation;
+	edge->run = tx->run_to_be_shown;
+	edge->led_on = run->led_on;
+	this_cpu_inc(tx->stats->edges);
+	this_cpu_add(tx->stats->busy_ns, run->units * tx->time_unit_ns);
+	if (run->led_on){
+		this_cpu_add(tx->stats->lit_ns, run->units * tx->time_unit_ns);
+	}
+	tx->elapsed_units += run->units;
+	tx->run_to_be_shown++;
+	publishStatus(tx, 1);
+	
+	return ktime_add_ns(tx->message_start, tx->elapsed_units * tx->time_unit_ns);
+}
+
+/* min-heap of transmitters by deadline of their next edge, called with sched->lock held */
+static void heapSwap(morse_scheduler* sched, int a, int b)
+{
+	morse_transmitter* tmp = sched->heap[a];
+	
+	sched->heap[a] = sched->heap[b];
+	sched->heap[b] = tmp;
+	sched->heap[a]->heap_index = a;
+	sched->heap[b]->heap_index = b;
+}
+
+static void heapUp(morse_scheduler* sched, int i)
+{
+	while (i > 0 && ktime_before(sched->heap[i]->deadline, sched->heap[(i - 1) / 2]->deadline)){
+		heapSwap(sched, i, (i - 1) / 2);
+		i = (i - 1) / 2;
+	}
+}
+
+static void heapDown(morse_scheduler* sched, int i)
+{
+	int earliest;
+	
+	while (2 * i + 1 < sched->heap_size){
+		earliest = 2 * i + 1;
+		if (earliest + 1 < sched->heap_size && ktime_before(sched->heap[earliest + 1]->deadline, sched->heap[earliest]->deadline)){
+			earliest++;
+		}
+		if (!ktime_before(sched->heap[earliest]->deadline, sched->heap[i]->deadline)){
+			break;
+		}
+		heapSwap(sched, i, earliest);
+		i = earliest;
+	}
+}
+
+static void heapPush(morse_scheduler* sched, morse_transmitter* tx)
+{
+	tx->heap_index = sched->heap_size++;
+	sched->heap[tx->heap_index] = tx;
+	heapUp(sched, tx->heap_index);
+}
+
+static void heapRemove(morse_scheduler* sched, morse_transmitter* tx)
+{
+	int i = tx->heap_index;
+	
+	tx->heap_index = -1;
+	if (i != --sched->heap_size){
+		sched->heap[i] = sched->heap[sched->heap_size];
+		sched->heap[i]->heap_index = i;
+		heapUp(sched, i);
+		heapDown(sched, sched->heap[i]->heap_index);
+	}
+}
+
+/* Shared timer callback, called at edge of transmitter which is due first. All edges due within coalesce_ns are shown by this single interrupt */
+static enum hrtimer_restart scheduler_callback(struct hrtimer *param)
+{
+	morse_scheduler* sched = container_of(param, morse_scheduler, timer);
+	morse_batch_edge* edge;
+	ktime_t limit;
+	ktime_t now;
+	ktime_t actual;
+	unsigned long flags;
+	int num_of_edges = 0;
+	int i = 0;
+	
+	/* soft timer can be interrupted by schedProgramOnCpu() on same CPU */
+	raw_spin_lock_irqsave(&sched->lock, flags);
+	
+	now = ktime_get();
+	limit = ktime_add_ns(now, coalesce_ns);
+	while (sched->heap_size > 0 && !ktime_after(sched->heap[0]->deadline, limit)){
+		edge = &sched->batch[num_of_edges];
+		edge->tx = sched->heap[0];
+		edge->scheduled = edge->tx->deadline;
+		heapRemove(sched, edge->tx);
+		edge->next = showEdge(edge->tx, edge, now, &sched->edges[num_of_edges]);
+		num_of_edges++;
+	}
+	
+	/* GPIOs of all transmitters in batch switch at once */
+	output->driveEdges(sched->edges, num_of_edges);
+	actual = ktime_get();
+	
+	for (i = 0; i < num_of_edges; i++){
+		edge = &sched->batch[i];
+		recordEdge(edge->tx, edge->scheduled, actual);
+		trace_morse_edge(edge->tx->id, edge->generation, edge->run, edge->led_on, edge->scheduled, actual);
+		if (edge->next != KTIME_MAX){
+			/* transmitter waits for its following edge, pushed only after batch so it isn't shown twice */
+			edge->tx->deadline = edge->next;
+			heapPush(sched, edge->tx);
+		}
+	}
+	
+	if (sched->heap_size == 0){
+		sched->expires = KTIME_MAX;
+		raw_spin_unlock_irqrestore(&sched->lock, flags);
+		
+		return HRTIMER_NORESTART;
+	}
+	
+	sched->expires = sched->heap[0]->deadline;
+	hrtimer_set_expires(&sched->timer, sched->expires);
+	raw_spin_unlock_irqrestore(&sched->lock, flags);
+	
+	return HRTIMER_RESTART;
+}
+
+/* soft or hard expiry is property of initialized timer, it has to match mode timer is started with. Called once at load */
+static void initScheduler(morse_scheduler* sched, int hard, int cpu)
+{
+	sched->mode = HRTIMER_MODE_ABS;
+	if (hard){
+		sched->mode |= HRTIMER_MODE_HARD;
+	}
+	if (cpu >= 0){
+		sched->mode |= HRTIMER_MODE_PINNED;
+	}
+	sched->cpu = cpu;
+	raw_spin_lock_init(&sched->lock);
+	sched->expires = KTIME_MAX;
+	sched->heap_size = 0;
+	
+	/* hrtimer_init() was replaced by hrtimer_setup() in 6.13 and removed in 6.15 */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 13, 0)
+	hrtimer_setup(&sched->timer, scheduler_callback, CLOCK_MONOTONIC, sched->mode);
+#else
+	hrtimer_init(&sched->timer, CLOCK_MONOTONIC, sched->mode);
+	sched->timer.function = &scheduler_callback;
+#endif
+}
+
+/* applies timer_hard and timer_cpu, transmitter moves to scheduler of that configuration. Called while transmitter isn't queued */
+static void timerConfig(morse_transmitter* tx)
+{
+	tx->timer_config = (tx->timer_hard ? 2 : 0) + ((tx->timer_cpu >= 0) ? 1 : 0);
+	tx->sched = (tx->timer_cpu >= 0) ? &per_cpu(pinned_schedulers[tx->timer_hard], tx->timer_cpu) : &unpinned_schedulers[tx->timer_hard];
+}
+
+/* programs timer for earliest deadline of scheduler. Called with sched->lock held, on its CPU if it is pinned */
+static void schedProgram(morse_scheduler* sched)
+{
+	if (sched->heap_size > 0){
+		sched->expires = sched->heap[0]->deadline;
+		hrtimer_start(&sched->timer, sched->expires, sched->mode);
+	}
+}
+
+static void schedProgramOnCpu(void* data)
+{
+	morse_scheduler* sched = data;
+	unsigned long flags;
+	
+	/* earliest deadline is read here, so latest of concurrent armTimer() calls can't program older one */
+	raw_spin_lock_irqsave(&sched->lock, flags);
+	schedProgram(sched);
+	raw_spin_unlock_irqrestore(&sched->lock, flags);
+}
+
+/* queues edge of transmitter, timer is programmed again only if it became earliest one of scheduler. Called with tx_mutex held */
+static void armTimer(morse_transmitter* tx, ktime_t expires)
+{
+	morse_scheduler* sched = tx->sched;
+	unsigned long flags;
+	int earliest;
+	
+	raw_spin_lock_irqsave(&sched->lock, flags);
+	tx->deadline = expires;
+	heapPush(sched, tx);
+	earliest = ktime_before(expires, sched->expires);
+	if (earliest && sched->cpu < 0){
+		schedProgram(sched);
+	}
+	raw_spin_unlock_irqrestore(&sched->lock, flags);
+	
+	/* pinned timer stays on CPU it was started on, so it is started from that CPU */
+	if (earliest && sched->cpu >= 0 && smp_call_function_single(sched->cpu, schedProgramOnCpu, sched, 1)){
+		/* CPU went offline in the meantime */
+		schedProgramOnCpu(sched);
+	}
+}
+
+/* takes transmitter out of its scheduler, returns 1 if it was queued (tx->deadline is then its next edge). Scheduler shows edges with its lock held, so transmitter isn't in the middle of edge afterwards */
+static int cancelTimer(morse_transmitter* tx)
+{
+	morse_scheduler* sched = tx->sched;
+	unsigned long flags;
+	int active;
+	
+	raw_spin_lock_irqsave(&sched->lock, flags);
+	active = (tx->heap_index >= 0);
+	if (active){
+		/* timer isn't programmed again, if it was its deadline it just finds nothing due */
+		heapRemove(sched, tx);
+	}
+	raw_spin_unlock_irqrestore(&sched->lock, flags);
+	
+	return active;
+}
+
+/* 1 while transmitter waits for its next edge or is being shown, i.e. while its edges are driven by scheduler */
+static int timerQueued(morse_transmitter* tx)
+{
+	morse_scheduler* sched = tx->sched;
+	unsigned long flags;
+	int queued;
+	
+	raw_spin_lock_irqsave(&sched->lock, flags);
+	queued = (tx->heap_index >= 0);
+	raw_spin_unlock_irqrestore(&sched->lock, flags);
+	
+	return queued;
+}
+
+/* (re)starts showing of message from its beginning, first edge is shown immediately. Called with tx_mutex held */
+static void startTransmission(morse_transmitter* tx, morse_message* message)
+{
+	cancelTimer(tx);
+	
+	driveOff(tx);
+	tx->run_to_be_shown = 0;
+	tx->elapsed_units = 0;
+	publishStatus(tx, 0);
+	
+	if (message == NULL){
+		return;
+	}
+	
+	/* suspended message continues from its cursor, first edge is start of its next character */
+	tx->run_to_be_shown = message->resume_run;
+	tx->elapsed_units = message->resume_units;
+	message->resume_run = 0;
+	message->resume_units = 0;
+	
+	spin_lock(&tx->tx_lock);
+	if (tx->shown_message != NULL && tx->shown_message != message){
+		putMessage(tx->shown_message);
+	}
+	spin_unlock(&tx->tx_lock);
+	tx->shown_message = message;
+	WRITE_ONCE(tx->blinking, 1);
+	
+	tx->message_start = ktime_sub_ns(ktime_get(), (u64)tx->elapsed_units * tx->time_unit_ns);
+	armTimer(tx, ktime_add_ns(tx->message_start, (u64)tx->elapsed_units * tx->time_unit_ns));
+}
+
+/* Fills empty stage with next message chosen by scheduler, and starts timer if it is stopped. Called with tx_mutex held */
+static void stageNext(morse_transmitter* tx)
+{
+	morse_message* message = NULL;
+	morse_message* staged;
+	
+	spin_lock(&tx->tx_lock);
+	staged = READ_ONCE(tx->staged_message);
+	if (staged != NULL && readyPriority(tx) > staged->priority){
+		/* message of higher class came after stage was filled, staged one is taken back unless timer took it meanwhile */
+		staged = xchg(&tx->staged_message, NULL);
+		if (staged != NULL){
+			list_add(&staged->suspended, &tx->suspended_messages);
+		}
+	}
+	if (READ_ONCE(tx->staged_message) == NULL){
+		message = nextMessage(tx);
+		if (message != NULL){
+			message->staged_at = ktime_get();
+		}
+		/* timer only takes from stage, so it can't be filled in meantime. Message is complete before timer can see it */
+		smp_store_release(&tx->staged_message, message);
+	}
+	spin_unlock(&tx->tx_lock);
+	
+	if (message != NULL){
+		/* place in queue is released, writers blocked on full queue may continue */
+		wake_up_interruptible(&tx->write_wait);
+		
+		/* streaming session is encoded lazily, only as much as is needed to keep its queue busy */
+		refillStream(message->session);
+	}
+	
+	smp_mb();
+	if (!READ_ONCE(tx->blinking) && !tx->removing){
+		/* timer has stopped (or is stopping and didn't see stage), whoever takes message from stage shows it */
+		message = xchg(&tx->staged_message, NULL);
+		if (message != NULL){
+			startTransmission(tx, message);
+			stageNext(tx);
+		}
+	}
+}
+
+static void stageWorkHandler(struct work_struct* work)
+{
+	morse_transmitter* tx = container_of(work, morse_transmitter, stage_work);
+	struct llist_node* retired;
+	morse_message* message;
+	morse_message* tmp;
+	
+	retired = llist_del_all(&tx->retired_messages);
+	if (retired != NULL){
+		spin_lock(&tx->tx_lock);
+		llist_for_each_entry_safe(message, tmp, retired, retired){
+			putMessage(message);
+		}
+		spin_unlock(&tx->tx_lock);
+		wake_up_interruptible(&tx->write_wait);
+	}
+	
+	mutex_lock(&tx->tx_mutex);
+	stageNext(tx);
+	mutex_unlock(&tx->tx_mutex);
+}
+
+/* copies statistics, so they aren't formatted with interrupts disabled */
+static void snapshotJitter(morse_transmitter* tx, morse_jitter* copy, int config)
+{
+	unsigned long flags;
+	
+	raw_spin_lock_irqsave(&tx->jitter_lock, flags);
+	*copy = tx->jitter[config];
+	raw_spin_unlock_irqrestore(&tx->jitter_lock, flags);
+}
+
+static void showJitter(struct seq_file* file, const morse_jitter* copy)
+{
+	u64 p99_ns = 0;
+	u64 below = 0;
+	int i = 0;
+	
+	/* upper bound of bucket which contains 99th percentile */
+	for (i = 0; i < JITTER_BUCKETS; i++){
+		below += copy->buckets[i];
+		if (below * 100 >= copy->edges * 99){
+			p99_ns = (i == JITTER_BUCKETS - 1) ? copy->max_late_ns : (1ULL << i) - 1;
+			break;
+		}
+	}
+	
+	seq_printf(file, "edges: %llu\n", copy->edges);
+	seq_printf(file, "missed_units: %llu\n", copy->missed_units);
+	seq_printf(file, "min_ns: %llu\n", copy->min_late_ns);
+	seq_printf(file, "max_ns: %llu\n", copy->max_late_ns);
+	seq_printf(file, "p99_ns: %llu\n", (copy->edges != 0) ? min(p99_ns, copy->max_late_ns) : 0);
+	seq_printf(file, "%12s %12s %12s\n", "from_ns", "to_ns", "edges");
+	for (i = 0; i < JITTER_BUCKETS; i++){
+		if (copy->buckets[i] != 0){
+			seq_printf(file, "%12llu %12llu %12llu\n", (i == 0) ? 0 : 1ULL << (i - 1), (i == JITTER_BUCKETS - 1) ? copy->max_late_ns : (1ULL << i) - 1, copy->buckets[i]);
+		}
+	}
+}
+
+static int jitter_show(struct seq_file* file, void* unused)
+{
+	static const char* const config_names[TIMER_CONFIGS] = { "soft", "soft_pinned", "hard", "hard_pinned" };
+	morse_transmitter* tx = file->private;
+	morse_jitter* copy;
+	int config = 0;
+	
+	copy = kmalloc(sizeof(*copy), GFP_KERNEL);
+	if (copy == NULL){
+		return -ENOMEM;
+	}
+	
+	seq_printf(file, "current: %s, cpu %d\n", config_names[tx->timer_config], tx->timer_cpu);
+	for (config = 0; config < TIMER_CONFIGS; config++){
+		snapshotJitter(tx, copy, config);
+		if (copy->edges != 0){
+			seq_printf(file, "\n[%s]\n", config_names[config]);
+			showJitter(file, copy);
+		}
+	}
+	
+	kfree(copy);
+	
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(jitter);
+
+static int jitter_log_show(struct seq_file* file, void* unused)
+{
+	morse_transmitter* tx = file->private;
+	morse_jitter* copy;
+	const morse_edge* edge;
+	u64 i = 0;
+	
+	copy = kmalloc(sizeof(*copy), GFP_KERNEL);
+	if (copy == NULL){
+		return -ENOMEM;
+	}
+	snapshotJitter(tx, copy, tx->timer_config);
+	
+	seq_printf(file, "%20s %20s %12s\n", "scheduled_ns", "actual_ns", "late_ns");
+	for (i = (copy->edges > JITTER_LOG_SIZE) ? copy->edges - JITTER_LOG_SIZE : 0; i < copy->edges; i++){
+		edge = &copy->log[i % JITTER_LOG_SIZE];
+		seq_printf(file, "%20lld %20lld %12lld\n", ktime_to_ns(edge->scheduled), ktime_to_ns(edge->actual), ktime_to_ns(ktime_sub(edge->actual, edge->scheduled)));
+	}
+	
+	kfree(copy);
+	
+	return 0;
+}
+DEFINE_SHOW_ATTRIBUTE(jitter_log);
+
+static ssize_t jitter_reset_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
+{
+	morse_transmitter* tx = file->private_data;
+	unsigned long flags;
+	
+	raw_spin_lock_irqsave(&tx->jitter_lock, flags);
+	memset(tx->jitter, 0, sizeof(tx->jitter));
+	raw_spin_unlock_irqrestore(&tx->jitter_lock, flags);
+	
+	return count;
+}
+
+static const struct file_operations jitter_reset_fops = {
+	.owner = THIS_MODULE,
+	.open = simple_open,
+	.write = jitter_reset_write
+};
+
+/* counter at offset of morse_stats summed over all CPUs */
+static u64 sumStats(morse_transmitter* tx, size_t offset)
+{
+	u64 sum = 0;
+	int cpu;
+	
+	for_each_possible_cpu(cpu){
+		sum += *(u64*)((char*)per_cpu_ptr(tx->stats, cpu) + offset);
+	}
+	
+	return sum;
+}
+
+#define STATS_ATTR(field) \
+static ssize_t field##_show(struct device* device, struct device_attribute* attr, char* buf) \
+{ \
+	return sysfs_emit(buf, "%llu\n", sumStats(dev_get_drvdata(device), offsetof(morse_stats, field))); \
+} \
+static DEVICE_ATTR_RO(field)
+
+STATS_ATTR(writes);
+STATS_ATTR(writes_queued);
+STATS_ATTR(writes_rejected);
+STATS_ATTR(bytes_written);
+STATS_ATTR(chars_encoded);
+STATS_ATTR(symbols_encoded);
+STATS_ATTR(encode_ns);
+STATS_ATTR(reads);
+STATS_ATTR(bytes_read);
+STATS_ATTR(ioctls);
+STATS_ATTR(ioctls_rejected);
+STATS_ATTR(edges);
+STATS_ATTR(lit_ns);
+STATS_ATTR(busy_ns);
+STATS_ATTR(preemptions);
+STATS_ATTR(preempt_ns);
+
+static ssize_t preempt_max_ns_show(struct device* device, struct device_attribute* attr, char* buf)
+{
+	morse_transmitter* tx = dev_get_drvdata(device);
+	
+	return sysfs_emit(buf, "%llu\n", READ_ONCE(tx->preempt_max_ns));
+}
+static DEVICE_ATTR_RO(preempt_max_ns);
+
+/* percent of time since load LED was showing messages, with two decimals */
+static ssize_t utilization_show(struct device* device, struct device_attribute* attr, char* buf)
+{
+	morse_transmitter* tx = dev_get_drvdata(device);
+	u64 busy_ns = sumStats(tx, offsetof(morse_stats, busy_ns));
+	u64 elapsed_ns = ktime_get_ns() - tx->load_time_ns;
+	u32 basis_points;
+	
+	/* busy time of run on LED is counted at its start, so it can run ahead of clock. Result is at most 10000, so it is split in 32 bits (plain 64-bit division doesn't link on 32-bit ARM), and product is kept in 128 bits, busy_ns * 10000 would wrap after 21 days */
+	basis_points = (busy_ns >= elapsed_ns) ? 10000 : (u32)mul_u64_u64_div_u64(busy_ns, 10000, elapsed_ns);
+	
+	return sysfs_emit(buf, "%u.%02u\n", basis_points / 100, basis_points % 100);
+}
+static DEVICE_ATTR_RO(utilization);
+
+static struct attribute* stats_attrs[] = {
+	&dev_attr_writes.attr,
+	&dev_attr_writes_queued.attr,
+	&dev_attr_writes_rejected.attr,
+	&dev_attr_bytes_written.attr,
+	&dev_attr_chars_encoded.attr,
+	&dev_attr_symbols_encoded.attr,
+	&dev_attr_encode_ns.attr,
+	&dev_attr_reads.attr,
+	&dev_attr_bytes_read.attr,
+	&dev_attr_ioctls.attr,
+	&dev_attr_ioctls_rejected.attr,
+	&dev_attr_edges.attr,
+	&dev_attr_lit_ns.attr,
+	&dev_attr_busy_ns.attr,
+	&dev_attr_preemptions.attr,
+	&dev_attr_preempt_ns.attr,
+	&dev_attr_preempt_max_ns.attr,
+	&dev_attr_utilization.attr,
+	NULL
+};
+
+static const struct attribute_group stats_group = {
+	.name = "stats",
+	.attrs = stats_attrs
+};
+
+static const struct attribute_group* morse_groups[] = {
+	&stats_group,
+	NULL
+};
+
+/* Linking device functions with file operations */ 
+static const struct file_operations test_fops = {
+	.owner = THIS_MODULE,
+	.open = morse_open,
+	.release = morse_release,
+	.read = morse_read,
+	.write = morse_write,
+	.unlocked_ioctl = morse_ioctl,
+#ifdef CONFIG_COMPAT
+	.compat_ioctl = morse_compat_ioctl,
+#endif
+	.poll = morse_poll,
+	.mmap = morse_mmap
+};
+
+/* reads LEDs and stripe GPIOs of transmitter from properties of its device (device tree node, or properties of device created from module parameters) */
+static int readGpios(morse_transmitter* tx, struct device* device)
+{
+	int num;
+	int i = 0;
+	
+	num = device_property_count_u32(device, PROP_LED_GPIOS);
+	if (num < 1 || num > 2 || device_property_read_u32_array(device, PROP_LED_GPIOS, (u32*)tx->led_gpios, num)){
+		dev_err(device, "%s has to hold one or two GPIOs\n", PROP_LED_GPIOS);
+		return -EINVAL;
+	}
+	if (num == 1){
+		/* single LED, both selectors drive it */
+		tx->led_gpios[LED_RIGHT] = tx->led_gpios[LED_LEFT];
+	}
+	
+	num = device_property_count_u32(device, PROP_STRIPE_GPIOS);
+	if (num > 0){
+		if (num > MORSE_MAX_LANES || device_property_read_u32_array(device, PROP_STRIPE_GPIOS, (u32*)tx->stripe_gpios, num)){
+			dev_err(device, "%s has to hold at most %d GPIOs\n", PROP_STRIPE_GPIOS, MORSE_MAX_LANES);
+			return -EINVAL;
+		}
+		tx->num_of_stripe_gpios = num;
+	} else{
+		/* messages are striped across LEDs of transmitter */
+		tx->stripe_gpios[tx->num_of_stripe_gpios++] = tx->led_gpios[LED_LEFT];
+		if (tx->led_gpios[LED_RIGHT] != tx->led_gpios[LED_LEFT]){
+			tx->stripe_gpios[tx->num_of_stripe_gpios++] = tx->led_gpios[LED_RIGHT];
+		}
+	}
+	
+	/* both LEDs and all stripe GPIOs are outputs, each of them claimed once */
+	for (num = 0; num < 2 + tx->num_of_stripe_gpios; num++){
+		tx->output_gpios[tx->num_of_output_gpios] = (num < 2) ? tx->led_gpios[num] : tx->stripe_gpios[num - 2];
+		for (i = 0; i < tx->num_of_output_gpios; i++){
+			if (tx->output_gpios[i] == tx->output_gpios[tx->num_of_output_gpios]){
+				break;
+			}
+		}
+		if (i == tx->num_of_output_gpios){
+			tx->num_of_output_gpios++;
+		}
+	}
+	
+	return 0;
+}
+
+/* creates transmitter of platform device: its LEDs, timer, device node, sysfs statistics and debugfs directory */
+static int morse_probe(struct platform_device* pdev)
+{
+	morse_transmitter* tx;
+	char name[16];
+	int ret_val;
+	int i = 0;
+	
+	tx = devm_kzalloc(&pdev->dev, sizeof(*tx), GFP_KERNEL);
+	if (tx == NULL){
+		return -ENOMEM;
+	}
+	platform_set_drvdata(pdev, tx);
+	
+	tx->selected_led = LED_LEFT;
+	tx->stripe_lanes = 1;
+	tx->time_unit_ns = DEFAULT_TIME_UNIT_NS;
+	tx->pending_led = tx->selected_led;
+	tx->pending_time_unit_ns = tx->time_unit_ns;
+	atomic64_set(&tx->live_time_unit_ns, 0);
+	tx->timer_hard = timer_hard;
+	tx->timer_cpu = timer_cpu;
+	tx->heap_index = -1;
+	raw_spin_lock_init(&tx->jitter_lock);
+	for (i = 0; i < MORSE_PRIORITY_LEVELS; i++){
+		INIT_LIST_HEAD(&tx->ready_sessions[i]);
+	}
+	INIT_LIST_HEAD(&tx->suspended_messages);
+	init_llist_head(&tx->preempted_messages);
+	init_llist_head(&tx->retired_messages);
+	init_waitqueue_head(&tx->write_wait);
+	init_waitqueue_head(&tx->read_wait);
+	spin_lock_init(&tx->tx_lock);
+	mutex_init(&tx->tx_mutex);
+	INIT_WORK(&tx->stage_work, stageWorkHandler);
+	INIT_DELAYED_WORK(&tx->beacon_work, beaconWorkHandler);
+	
+	ret_val = readGpios(tx, &pdev->dev);
+	if (ret_val != 0){
+		return ret_val;
+	}
+	
+	tx->stats = alloc_percpu(morse_stats);
+	if (tx->stats == NULL){
+		return -ENOMEM;
+	}
+	tx->load_time_ns = ktime_get_ns();
+	
+	/* page shared with user space */
+	BUILD_BUG_ON(sizeof(morse_shared_page) > PAGE_SIZE);
+	tx->shared_page = (morse_shared_page*)get_zeroed_page(GFP_KERNEL);
+	if (tx->shared_page == NULL){
+		dev_err(&pdev->dev, "Failed to allocate shared page\n");
+		ret_val = -ENOMEM;
+		goto page_error;
+	}
+	
+	/* LEDs related inits, both LEDs and all stripe GPIOs are outputs which are off initially */
+	tx->output_data = output->setup(&pdev->dev, tx->output_gpios, tx->num_of_output_gpios);
+	if (IS_ERR(tx->output_data)){
+		dev_err(&pdev->dev, "Failed to set up %s output\n", output->name);
+		ret_val = PTR_ERR(tx->output_data);
+		goto output_error;
+	}
+	mapOutputs(tx);
+	WRITE_ONCE(tx->blinking, 0);
+	
+	/* Transmitter joins shared timer of its configuration. It is queued by first write */
+	if (tx->timer_cpu >= 0 && (tx->timer_cpu >= nr_cpu_ids || !cpu_online(tx->timer_cpu))){
+		dev_err(&pdev->dev, "CPU %d is not online\n", tx->timer_cpu);
+		ret_val = -EINVAL;
+		goto timer_error;
+	}
+	timerConfig(tx);
+	publishStatus(tx, 0);
+	
+	tx->id = ida_alloc_max(&morse_ida, MORSE_MAX_INSTANCES - 1, GFP_KERNEL);
+	if (tx->id < 0){
+		dev_err(&pdev->dev, "There are already %d transmitters\n", MORSE_MAX_INSTANCES);
+		ret_val = tx->id;
+		goto timer_error;
+	}
+	
+	/* char device and its node */
+	cdev_init(&tx->cdev, &test_fops);
+	tx->cdev.owner = THIS_MODULE;
+	if (cdev_add(&tx->cdev, MKDEV(MAJOR(dev), tx->id), 1)){
+		dev_err(&pdev->dev, "Char driver registration failed\n");
+		ret_val = -EBUSY;
+		goto add_error;
+	}
+	tx->device = device_create_with_groups(morse_class, &pdev->dev, MKDEV(MAJOR(dev), tx->id), tx, morse_groups, "morse_dev%d", tx->id);
+	if (IS_ERR(tx->device)){
+		dev_err(&pdev->dev, "Failed to create device\n");
+		ret_val = PTR_ERR(tx->device);
+		goto device_error;
+	}
+	
+	/* debugfs is optional, driver works without it */
+	snprintf(name, sizeof(name), "morse_dev%d", tx->id);
+	tx->debugfs_dir = debugfs_create_dir(name, debugfs_root);
+	debugfs_create_file("jitter", 0444, tx->debugfs_dir, tx, &jitter_fops);
+	debugfs_create_file("edges", 0444, tx->debugfs_dir, tx, &jitter_log_fops);
+	debugfs_create_file("reset", 0200, tx->debugfs_dir, tx, &jitter_reset_fops);
+	
+	dev_info(&pdev->dev, "Transmitter /dev/morse_dev%d on GPIO %d and %d\n", tx->id, tx->led_gpios[LED_LEFT], tx->led_gpios[LED_RIGHT]);
+	
+	return 0;
+	
+device_error:
+	cdev_del(&tx->cdev);
+	
+add_error:
+	ida_free(&morse_ida, tx->id);
+	
+timer_error:
+	output->release(tx->output_data);
+	
+output_error:
+	free_page((unsigned long)tx->shared_page);
+	
+page_error:
+	free_percpu(tx->stats);
+	
+	return ret_val;
+}
+
+/* bind attributes of driver are suppressed, so transmitter is removed only when module is unloaded, i.e. when none of its files is open */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 11, 0)
+static void morse_remove(struct platform_device* pdev)
+#else
+static int morse_remove(struct platform_device* pdev)
+#endif
+{
+	morse_transmitter* tx = platform_get_drvdata(pdev);
+	morse_session* session;
+	morse_session* next_session;
+	morse_message* message;
+	morse_message* next_message;
+	int i = 0;
+	
+	debugfs_remove_recursive(tx->debugfs_dir);
+	
+	/* beacon and stage work can start timer through stageNext(), so they are stopped before it is cancelled and can't start it again */
+	mutex_lock(&tx->tx_mutex);
+	tx->removing = 1;
+	mutex_unlock(&tx->tx_mutex);
+	cancel_delayed_work_sync(&tx->beacon_work);
+	cancel_work_sync(&tx->stage_work);
+	cancelTimer(tx);
+	driveOff(tx);
+	
+	/* timer could queue them once more before it was cancelled, now nothing does */
+	cancel_delayed_work_sync(&tx->beacon_work);
+	cancel_work_sync(&tx->stage_work);
+	
+	/* beacon is the only session which outlives its file handle */
+	if (tx->beacon != NULL){
+		closeSession(tx->beacon);
+		tx->beacon = NULL;
+	}
+	
+	/* all file handles are closed, so sessions are kept only by their messages */
+	spin_lock(&tx->tx_lock);
+	for (i = 0; i < MORSE_PRIORITY_LEVELS; i++){
+		list_for_each_entry_safe(session, next_session, &tx->ready_sessions[i], ready){
+			list_del_init(&session->ready);
+			while (kfifo_get(&session->pending_messages, &message)){
+				putMessage(message);
+			}
+		}
+	}
+	llist_for_each_entry_safe(message, next_message, llist_del_all(&tx->preempted_messages), preempted){
+		putMessage(message);
+	}
+	list_for_each_entry_safe(message, next_message, &tx->suspended_messages, suspended){
+		list_del(&message->suspended);
+		putMessage(message);
+	}
+	if (tx->stream_session != NULL){
+		putSession(tx->stream_session);
+		tx->stream_session = NULL;
+	}
+	llist_for_each_entry_safe(message, next_message, llist_del_all(&tx->retired_messages), retired){
+		putMessage(message);
+	}
+	if (tx->staged_message != NULL){
+		putMessage(tx->staged_message);
+	}
+	if (tx->shown_message != NULL){
+		putMessage(tx->shown_message);
+	}
+	if (tx->latest_message != NULL){
+		putMessage(tx->latest_message);
+	}
+	for (i = 0; i < MORSE_MAX_TEMPLATES; i++){
+		if (tx->templates[i] != NULL){
+			putTemplate(tx->templates[i]);
+		}
+	}
+	spin_unlock(&tx->tx_lock);
+	
+	output->release(tx->output_data);
+	
+	device_destroy(morse_class, MKDEV(MAJOR(dev), tx->id));
+	cdev_del(&tx->cdev);
+	ida_free(&morse_ida, tx->id);
+	free_percpu(tx->stats);
+	
+	/* pages still mapped by user space keep their own reference */
+	free_page((unsigned long)tx->shared_page);
+#if LINUX_VERSION_CODE < KERNEL_VERSION(6, 11, 0)
+	
+	return 0;
+#endif
+}
+
+static const struct of_device_id morse_of_match[] = {
+	{ .compatible = OF_COMPATIBLE },
+	{ }
+};
+MODULE_DEVICE_TABLE(of, morse_of_match);
+
+static struct platform_driver morse_driver = {
+	.probe = morse_probe,
+	.remove = morse_remove,
+	.driver = {
+		.name = DRIVER_NAME,
+		.of_match_table = morse_of_match,
+		.suppress_bind_attrs = true
+	}
+};
+
+/* without device tree nodes, transmitter i is platform device with left_gpios[i] and right_gpios[i] (and stripe_gpios if it is first one) as its properties */
+static int createParamDevices(void)
+{
+	struct property_entry properties[3];
+	struct platform_device_info info;
+	u32 leds[2];
+	int i = 0;
+	
+	for (i = 0; i < num_of_left_gpios; i++){
+		leds[0] = left_gpios[i];
+		leds[1] = (i < num_of_right_gpios) ? right_gpios[i] : -1;
+		
+		memset(properties, 0, sizeof(properties));
+		properties[0] = PROPERTY_ENTRY_U32_ARRAY_LEN(PROP_LED_GPIOS, leds, ((int)leds[1] < 0) ? 1 : 2);
+		if (i == 0 && num_of_stripe_gpios > 0){
+			properties[1] = PROPERTY_ENTRY_U32_ARRAY_LEN(PROP_STRIPE_GPIOS, stripe_gpios, num_of_stripe_gpios);
+		}
+		
+		/* properties are copied by platform core */
+		memset(&info, 0, sizeof(info));
+		info.name = DRIVER_NAME;
+		info.id = i;
+		info.properties = properties;
+		param_devices[i] = platform_device_register_full(&info);
+		if (IS_ERR(param_devices[i])){
+			pr_err("Failed to create transmitter %d\n", i);
+			return PTR_ERR(param_devices[i]);
+		}
+		num_of_param_devices++;
+	}
+	
+	return 0;
+}
+
+static void removeParamDevices(void)
+{
+	while (num_of_param_devices > 0){
+		platform_device_unregister(param_devices[--num_of_param_devices]);
+	}
+}
+
+static int __init morse_init(void) {
+
+	struct device_node* node;
+	int ret_val;
+	int cpu;
+	int hard = 0;
+	
+	pr_info("Hello from Morse module\n");
+	
+	/* high resolution timers shared by transmitters, they are started by first write */
+	for (hard = 0; hard < 2; hard++){
+		initScheduler(&unpinned_schedulers[hard], hard, -1);
+		for_each_possible_cpu(cpu){
+			initScheduler(&per_cpu(pinned_schedulers[hard], cpu), hard, cpu);
+		}
+	}
+	
+	/* backend is shared by all transmitters, each of them claims its own GPIOs */
+	if (strcmp(output_name, morse_output_mmio.name) == 0){
+		output = &morse_output_mmio;
+	} else{
+		if (strcmp(output_name, morse_output_gpiod.name) == 0){
+			output = &morse_output_gpiod;
+		} else{
+			pr_err("Unknown output %s\n", output_name);
+			return -EINVAL;
+		}
+	}
+	
+	/* dynamically allocate major and minors of all transmitters */
+	ret_val = alloc_chrdev_region(&dev, 0, MORSE_MAX_INSTANCES, DRIVER_NAME);
+	if (ret_val != 0) {
+		pr_err("Failed to allocate device number\n");
+		goto alloc_error;
+	}
+	
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 4, 0)
+	morse_class = class_create("morse");
+#else
+	morse_class = class_create(THIS_MODULE, "morse");
+#endif
+	if (IS_ERR(morse_class)){
+		pr_err("Failed to create device class\n");
+		ret_val = PTR_ERR(morse_class);
+		goto class_error;
+	}
+	
+	debugfs_root = debugfs_create_dir(DRIVER_NAME, NULL);
+	
+	ret_val = platform_driver_register(&morse_driver);
+	if (ret_val != 0){
+		pr_err("Failed to register platform driver\n");
+		goto driver_error;
+	}
+	
+	/* transmitters in device tree are probed by platform core */
+	node = of_find_compatible_node(NULL, NULL, OF_COMPATIBLE);
+	if (node == NULL){
+		ret_val = createParamDevices();
+		if (ret_val != 0){
+			goto devices_error;
+		}
+	}
+	of_node_put(node);
+	
+	return 0;
+	
+devices_error:
+	removeParamDevices();
+	platform_driver_unregister(&morse_driver);
+	
+driver_error:
+	debugfs_remove_recursive(debugfs_root);
+	class_destroy(morse_class);
+	
+class_error:
+	unregister_chrdev_region(dev, MORSE_MAX_INSTANCES);
+	
+alloc_error:
+	return ret_val;
+}
+
+static void __exit morse_exit(void) {
+
+	int cpu;
+	int hard = 0;
+	
+	pr_info("Goodbye from Morse module\n");
+	
+	removeParamDevices();
+	platform_driver_unregister(&morse_driver);
+	
+	/* schedulers are empty now, they can only expire once more for transmitter taken from them */
+	for (hard = 0; hard < 2; hard++){
+		hrtimer_cancel(&unpinned_schedulers[hard].timer);
+		for_each_possible_cpu(cpu){
+			hrtimer_cancel(&per_cpu(pinned_schedulers[hard], cpu).timer);
+		}
+	}
+	
+	debugfs_remove_recursive(debugfs_root);
+	class_destroy(morse_class);
+	unregister_chrdev_region(dev, MORSE_MAX_INSTANCES);
+}
+
+/* new session of file handle (or of beacon), returns NULL if there is no memory */
+static morse_session* allocSession(morse_transmitter* tx)
+{
+	morse_session* session;
+	int i = 0;
+	
+	/* messages are big (edge schedule is kept with them), so vmalloc is used if contiguous memory isn't available */
+	session = kvzalloc(sizeof(*session), GFP_KERNEL);
+	if (session == NULL){
+		return NULL;
+	}
+	
+	session->tx = tx;
+	session->mode = NORMAL;
+	session->format = READ_ASCII;
+	session->weight = 1;
+	session->users = 1;
+	INIT_LIST_HEAD(&session->ready);
+	INIT_KFIFO(session->pending_messages);
+	INIT_KFIFO(session->free_messages);
+	INIT_KFIFO(session->stream_data);
+	mutex_init(&session->stream_mutex);
+	for (i = 0; i < MESSAGES_PER_SESSION; i++){
+		session->messages[i].session = session;
+		kfifo_put(&session->free_messages, &session->messages[i]);
+	}
+	
+	return session;
+}
+
+/* queued messages are still shown after session is closed, it is freed together with last of them */
+static void closeSession(morse_session* session)
+{
+	morse_transmitter* tx = session->tx;
+	
+	spin_lock(&tx->tx_lock);
+	if (session->latest_message != NULL){
+		putMessage(session->latest_message);
+		session->latest_message = NULL;
+	}
+	putSession(session);
+	spin_unlock(&tx->tx_lock);
+}
+
+static int morse_open(struct inode *inode, struct file *file)
+{
+	morse_transmitter* tx = container_of(inode->i_cdev, morse_transmitter, cdev);
+	morse_session* session;
+	
+	session = allocSession(tx);
+	if (session == NULL){
+		return -ENOMEM;
+	}
+	
+	file->private_data = session;
+	
+	return 0;
+}
+
+static int morse_release(struct inode *inode, struct file *file)
+{
+	closeSession(file->private_data);
+	
+	return 0;
+}
+
+/* returns message read through session should return (with reference taken) or NULL if nothing is written yet */
+static morse_message* readableMessage(morse_session* session)
+{
+	morse_transmitter* tx = session->tx;
+	morse_message* message;
+	
+	spin_lock(&tx->tx_lock);
+	message = (session->latest_message != NULL) ? session->latest_message : tx->latest_message;
+	if (message != NULL){
+		getMessage(message);
+	}
+	spin_unlock(&tx->tx_lock);
+	
+	return message;
+}
+
+static void releaseMessage(morse_message* message)
+{
+	morse_transmitter* tx = message->session->tx;
+	int freed;
+	
+	spin_lock(&tx->tx_lock);
+	freed = putMessage(message);
+	spin_unlock(&tx->tx_lock);
+	
+	/* reader could hold last message which kept writer out of free messages */
+	if (freed){
+		wake_up_interruptible(&tx->write_wait);
+	}
+}
+
+static ssize_t morse_read(struct file *file, char __user *buf, size_t count, loff_t *ppos)
+{
+	morse_session* session = file->private_data;
+	morse_transmitter* tx = session->tx;
+	char rendered[RENDER_CHUNK];
+	morse_message* message;
+	int available = 0;
+	int remainingToRead;
+	int to_transfer;
+	int transferred = 0;
+	int chunk;
+	int ret_val = 0;
+
+	this_cpu_inc(tx->stats->reads);
+	
+	message = readableMessage(session);
+	if (message == NULL){
+		return 0;
+	}
+	
+	/* newer message was written since last read on this file handle, so reading starts from its beginning */
+	if (message->generation != session->read_generation){
+		session->read_generation = message->generation;
+		*ppos = 0;
+	}
+	
+	available = (session->format == READ_PACKED) ? MORSE_PACKED_SIZE(message->encoding->encodedDataLength) : message->encoding->encodedDataLength;
+	/* offset is 64-bit and pread can pass any, so it is compared before remainder is narrowed to int */
+	if (*ppos < 0 || *ppos >= available){
+		remainingToRead = 0;
+	} else{
+		remainingToRead = available - (int)*ppos;  // remaining data to be read 
+	}
+
+	/* if user app requests more than we can provide, we will do our best and provide everything we have */
+	to_transfer = min_t(size_t, count, remainingToRead);
+	
+	if (session->format == READ_PACKED){
+		if (copy_to_user(buf, message->encoding->encodedData + *ppos, to_transfer) != 0) {
+			ret_val = -EFAULT;
+		}
+	} else{
+		/* symbols are rendered piece by piece, ASCII form is never kept in driver */
+		while (transferred < to_transfer){
+			chunk = min(to_transfer - transferred, RENDER_CHUNK);
+			morse_render(message->encoding->encodedData, *ppos + transferred, chunk, rendered);
+			if (copy_to_user(buf + transferred, rendered, chunk) != 0) {
+				ret_val = -EFAULT;
+				break;
+			}
+			transferred += chunk;
+		}
+	}
+	
+	releaseMessage(message);
+	
+	if (ret_val != 0){
+		return ret_val;
+	}
+	
+	/* cat will be kept invoked until it returns zero, so avoid printing zero characters to log in last iteration */
+	if (to_transfer != 0){
+		//pr_info("Sending data to user app...\n");
+		//pr_info("Sent %d characters to app side\n", to_transfer);
+	}		
+	*ppos += to_transfer;
+	this_cpu_add(tx->stats->bytes_read, to_transfer);
+	
+	return to_transfer;
+}
+
+/* writer may reserve message only if its queue isn't full */
+static int queueHasSpace(morse_session* session)
+{
+	return kfifo_len(&session->pending_messages) + session->messages_being_encoded < QUEUE_CAPACITY && !kfifo_is_empty(&session->free_messages);
+}
+
+/* takes free message for encoding, returns NULL if queue is full */
+static morse_message* reserveMessage(morse_session* session)
+{
+	morse_transmitter* tx = session->tx;
+	morse_message* message = NULL;
+	
+	spin_lock(&tx->tx_lock);
+	if (queueHasSpace(session) && kfifo_get(&session->free_messages, &message)){
+		session->messages_being_encoded++;
+	} else{
+		message = NULL;
+	}
+	spin_unlock(&tx->tx_lock);
+	
+	return message;
+}
+
+/* puts encoded message into queue of its session and makes it last written one. Called with tx_mutex held */
+static void queueMessage(morse_session* session, morse_message* message)
+{
+	morse_transmitter* tx = session->tx;
+	morse_message* replaced[2];
+	
+	spin_lock(&tx->tx_lock);
+	session->messages_being_encoded--;
+	message->generation = ++tx->messages_written;
+	getMessage(message);			/* queue/stage/LED */
+	kfifo_put(&session->pending_messages, message);
+	if (list_empty(&session->ready)){
+		list_add_tail(&session->ready, &tx->ready_sessions[session->priority]);
+	}
+	replaced[0] = session->latest_message;
+	replaced[1] = tx->latest_message;
+	getMessage(message);
+	session->latest_message = message;
+	getMessage(message);
+	tx->latest_message = message;
+	if (replaced[0] != NULL){
+		putMessage(replaced[0]);
+	}
+	if (replaced[1] != NULL){
+		putMessage(replaced[1]);
+	}
+	spin_unlock(&tx->tx_lock);
+	
+	trace_morse_message_queued(tx->id, message->generation, message->encoding->encodedDataLength, kfifo_len(&session->pending_messages));
+	publishStream(tx, message);
+}
+
+/* encodes text in work mode mode and with striping in effect, encoding is owned by caller so no lock is taken. Encoder overwrites whole buffer, no need to clear it */
+static void encode(morse_transmitter* tx, morse_encoding* encoding, const char* rawData, int len, work_mode mode)
+{
+	int first[MORSE_MAX_LANES];
+	int count[MORSE_MAX_LANES];
+	int lanes = READ_ONCE(tx->stripe_lanes);
+	int i = 0;
+	u64 start = ktime_get_ns();
+	
+	encoding->mode = mode;
+	encoding->lanes = lanes;
+	trace_morse_encode_start(tx->id, len, mode, lanes);
+	
+	if (lanes == 1){
+		encoding->encodedDataLength = morse_encode_packed(rawData, len, encoding->encodedData, 0, mode);
+		
+		/* all LED edges are known in advance, timer only walks through them */
+		encoding->scheduleLength = morse_schedule(encoding->encodedData, 0, encoding->encodedDataLength, encoding->schedule);
+	} else{
+		/* parts are encoded one after another, so encodedData still holds whole message (for read), lane i is its symbols from first[i] */
+		encoding->encodedDataLength = 0;
+		for (i = 0; i < lanes; i++){
+			first[i] = encoding->encodedDataLength;
+			count[i] = morse_encode_packed(rawData + len * i / lanes, len * (i + 1) / lanes - len * i / lanes, encoding->encodedData, first[i], mode);
+			encoding->encodedDataLength += count[i];
+		}
+		encoding->scheduleLength = morse_schedule_lanes(encoding->encodedData, first, count, lanes, encoding->schedule);
+	}
+	
+	trace_morse_encode_end(tx->id, len, encoding->encodedDataLength, encoding->scheduleLength);
+	this_cpu_add(tx->stats->encode_ns, ktime_get_ns() - start);
+	this_cpu_add(tx->stats->chars_encoded, len);
+	this_cpu_add(tx->stats->symbols_encoded, encoding->encodedDataLength);
+}
+
+/* message is owned by caller until it is queued */
+static void encodeMessage(morse_session* session, morse_message* message, const char* rawData, int len)
+{
+	encode(session->tx, &message->own, rawData, len, session->mode);
+	message->encoding = &message->own;
+}
+
+/* encodes next chunks of streamed text until STREAM_LOOKAHEAD of them wait in queue. Called with tx_mutex held */
+static void refillStream(morse_session* session)
+{
+	morse_transmitter* tx = session->tx;
+	char rawData[STREAM_CHUNK];
+	morse_message* message;
+	int len;
+	
+	while (!kfifo_is_empty(&session->stream_data) && kfifo_len(&session->pending_messages) + session->messages_being_encoded < STREAM_LOOKAHEAD){
+		message = reserveMessage(session);
+		if (message == NULL){
+			/* should not happen, STREAM_LOOKAHEAD is far bellow MESSAGES_PER_SESSION */
+			return;
+		}
+		len = kfifo_out(&session->stream_data, rawData, STREAM_CHUNK);
+		encodeMessage(session, message, rawData, len);
+		queueMessage(session, message);
+	}
+	
+	/* writers blocked on full stream buffer may continue */
+	wake_up_interruptible(&tx->write_wait);
+	wake_up_interruptible(&tx->read_wait);
+}
+
+/* streaming mode write, text is only appended to buffer, at most first chunk is encoded before returning */
+static ssize_t streamWrite(struct file *file, morse_session* session, const char __user *buf, size_t count)
+{
+	morse_transmitter* tx = session->tx;
+	unsigned int copied = 0;
+	int ret_val;
+	
+	if (mutex_lock_interruptible(&session->stream_mutex)){
+		return -ERESTARTSYS;
+	}
+	
+	while (kfifo_is_full(&session->stream_data)){
+		mutex_unlock(&session->stream_mutex);
+		if (file->f_flags & O_NONBLOCK){
+			return -EAGAIN;
+		}
+		if (wait_event_interruptible(tx->write_wait, !kfifo_is_full(&session->stream_data))){
+			return -ERESTARTSYS;
+		}
+		if (mutex_lock_interruptible(&session->stream_mutex)){
+			return -ERESTARTSYS;
+		}
+	}
+	
+	ret_val = kfifo_from_user(&session->stream_data, buf, count, &copied);
+	mutex_unlock(&session->stream_mutex);
+	if (ret_val != 0){
+		return ret_val;
+	}
+	
+	mutex_lock(&tx->tx_mutex);
+	refillStream(session);
+	stageNext(tx);
+	mutex_unlock(&tx->tx_mutex);
+	
+	return copied;
+}
+
+static ssize_t messageWrite(struct file *file, morse_session* session, const char __user *buf, size_t count)
+{	
+	morse_transmitter* tx = session->tx;
+	char rawData[MAX_NUM_OF_CHARS_TO_BE_ENCODED];
+	morse_message* message = NULL;
+	int to_transfer = count;
+	
+	/* protection from case when application wants to write more than driver's module can accept in buffer, our best is to take as much as we can, rest won't be written */
+	if (to_transfer > MAX_NUM_OF_CHARS_TO_BE_ENCODED){
+		to_transfer = MAX_NUM_OF_CHARS_TO_BE_ENCODED;
+	}
+	
+	//pr_info("Transfering %d characters from app side\n", to_transfer);
+	
+	if (copy_from_user(rawData, buf, to_transfer) != 0) {
+		pr_info("Transfering failed\n");
+		return -EFAULT;
+	}
+	
+	/* reserve place in queue, if it is full wait until timer takes next message from it */
+	while ((message = reserveMessage(session)) == NULL){
+		if (file->f_flags & O_NONBLOCK){
+			return -EAGAIN;
+		}
+		if (wait_event_interruptible(tx->write_wait, queueHasSpace(session))){
+			return -ERESTARTSYS;
+		}
+	}
+	
+	encodeMessage(session, message, rawData, to_transfer);
+	
+	/* scheduler stages message once its session is on turn, it is shown immediately if LED is idle */
+	mutex_lock(&tx->tx_mutex);
+	queueMessage(session, message);
+	stageNext(tx);
+	mutex_unlock(&tx->tx_mutex);
+	
+	/* replaced message can belong to other session whose writer waits for it */
+	wake_up_interruptible(&tx->write_wait);
+	wake_up_interruptible(&tx->read_wait);
+	
+	return to_transfer;
+}
+
+static ssize_t morse_write(struct file *file, const char __user *buf, size_t count, loff_t *ppos)
+{
+	morse_session* session = file->private_data;
+	morse_transmitter* tx = session->tx;
+	int busy = READ_ONCE(tx->blinking);
+	ssize_t ret_val;
+	
+	if (session->streaming){
+		ret_val = streamWrite(file, session, buf, count);
+	} else{
+		ret_val = messageWrite(file, session, buf, count);
+	}
+	
+	if (ret_val < 0){
+		trace_morse_write_rejected(tx->id, count, ret_val, session->streaming, busy);
+		this_cpu_inc(tx->stats->writes_rejected);
+	} else{
+		trace_morse_write_accepted(tx->id, count, ret_val, session->streaming, busy);
+		this_cpu_inc(tx->stats->writes);
+		this_cpu_add(tx->stats->bytes_written, ret_val);
+		if (busy){
+			this_cpu_inc(tx->stats->writes_queued);
+		}
+	}
+	
+	return ret_val;
+}
+
+/* all fields of config are checked before any of them is applied */
+static int validateConfig(morse_transmitter* tx, const struct morse_config* config)
+{
+	u32 flags = config->flags;
+	
+	if (flags & ~(MORSE_CONFIG_FIELDS | MORSE_CONFIG_NOW | MORSE_CONFIG_REPLAY)){
+		return -EINVAL;
+	}
+	if ((flags & MORSE_CONFIG_MODE) && config->mode > ERROR){
+		return -EINVAL;
+	}
+	if ((flags & MORSE_CONFIG_READ_FORMAT) && config->read_format > READ_PACKED){
+		return -EINVAL;
+	}
+	if ((flags & MORSE_CONFIG_WEIGHT) && (config->weight < 1 || config->weight > QUEUE_CAPACITY)){
+		return -EINVAL;
+	}
+	if ((flags & MORSE_CONFIG_STREAMING) && config->streaming > 1){
+		return -EINVAL;
+	}
+	if ((flags & MORSE_CONFIG_LED) && config->led > LED_RIGHT){
+		return -EINVAL;
+	}
+	if ((flags & MORSE_CONFIG_TIME_UNIT) && (config->time_unit_ns < MIN_TIME_UNIT_NS || config->time_unit_ns > MAX_TIME_UNIT_NS)){
+		return -EINVAL;
+	}
+	if ((flags & MORSE_CONFIG_LANES) && (config->lanes < 1 || config->lanes > tx->num_of_stripe_gpios)){
+		return -EINVAL;
+	}
+	if ((flags & MORSE_CONFIG_PRIORITY) && config->priority >= MORSE_PRIORITY_LEVELS){
+		return -EINVAL;
+	}
+	if ((flags & MORSE_CONFIG_TIMER) && (config->timer_hard > 1 || (config->timer_cpu != -1 && (config->timer_cpu < 0 || config->timer_cpu >= nr_cpu_ids || !cpu_online(config->timer_cpu))))){
+		return -EINVAL;
+	}
+	
+	return 0;
+}
+
+/* applies validated config. LED and time unit wait for message boundary unless MORSE_CONFIG_NOW is set, message on LED is restarted only with MORSE_CONFIG_REPLAY */
+static void applyConfig(morse_session* session, const struct morse_config* config)
+{
+	morse_transmitter* tx = session->tx;
+	u32 flags = config->flags;
+	ktime_t next_edge;
+	int active;
+	
+	/* session configuration, it has nothing to do with message on LED */
+	if (flags & MORSE_CONFIG_MODE){
+		session->mode = (config->mode == 0) ? NORMAL : ERROR;
+	}
+	if (flags & MORSE_CONFIG_READ_FORMAT){
+		session->format = (config->read_format == 0) ? READ_ASCII : READ_PACKED;
+	}
+	if (flags & MORSE_CONFIG_WEIGHT){
+		/* num of messages this session may show in a row while other sessions wait */
+		session->weight = config->weight;
+	}
+	if (flags & MORSE_CONFIG_STREAMING){
+		/* text which is already buffered is still shown after switching it off */
+		session->streaming = config->streaming;
+	}
+	if (flags & MORSE_CONFIG_LANES){
+		/* messages which are already encoded keep their striping */
+		WRITE_ONCE(tx->stripe_lanes, config->lanes);
+	}
+	if (flags & MORSE_CONFIG_PRIORITY){
+		/* messages which are already queued go with session to its new class */
+		spin_lock(&tx->tx_lock);
+		session->priority = config->priority;
+		if (!list_empty(&session->ready)){
+			list_move_tail(&session->ready, &tx->ready_sessions[session->priority]);
+			session->burst = 0;
+		}
+		spin_unlock(&tx->tx_lock);
+		
+		/* staged message is taken back if session outranks it now */
+		mutex_lock(&tx->tx_mutex);
+		stageNext(tx);
+		mutex_unlock(&tx->tx_mutex);
+	}
+	
+	if (!(flags & (MORSE_CONFIG_LED | MORSE_CONFIG_TIME_UNIT | MORSE_CONFIG_TIMER | MORSE_CONFIG_REPLAY))){
+		return;
+	}
+	
+	/* transmitter configuration, shared by all sessions */
+	mutex_lock(&tx->tx_mutex);
+	
+	/* timer is stopped only for the moment of change and armed again for same edge, so showing continues where it was */
+	active = cancelTimer(tx);
+	next_edge = tx->deadline;
+	
+	/* rate requested before this call is overridden by it */
+	applyLiveRate(tx, next_edge);
+	if (flags & MORSE_CONFIG_LED){
+		tx->pending_led = config->led;
+		tx->config_pending = 1;
+	}
+	if (flags & MORSE_CONFIG_TIME_UNIT){
+		tx->pending_time_unit_ns = config->time_unit_ns;
+		tx->config_pending = 1;
+	}
+	if (!active || (flags & (MORSE_CONFIG_NOW | MORSE_CONFIG_REPLAY))){
+		applyPendingConfig(tx, next_edge);
+	}
+	if (flags & MORSE_CONFIG_TIMER){
+		/* timer is initialized for new configuration */
+		tx->timer_hard = config->timer_hard;
+		tx->timer_cpu = config->timer_cpu;
+		timerConfig(tx);
+	}
+	
+	if (flags & MORSE_CONFIG_REPLAY){
+		/* message on LED (or last shown one) is shown once again from its beginning */
+		startTransmission(tx, tx->shown_message);
+	} else{
+		if (active){
+			/* run on LED is shown on new LED if it was changed */
+			if (tx->run_to_be_shown > 0){
+				driveRun(tx, tx->shown_message, tx->shown_message->encoding->schedule[tx->run_to_be_shown - 1].led_on);
+			}
+			publishStatus(tx, 1);
+			armTimer(tx, next_edge);
+		} else{
+			publishStatus(tx, 0);
+		}
+	}
+	
+	mutex_unlock(&tx->tx_mutex);
+}
+
+/* values which are (or will be at message boundary) in effect for this session */
+static void getConfig(morse_session* session, struct morse_config* config)
+{
+	morse_transmitter* tx = session->tx;
+	memset(config, 0, sizeof(*config));
+	config->flags = MORSE_CONFIG_FIELDS;
+	config->mode = session->mode;
+	config->read_format = session->format;
+	config->weight = session->weight;
+	config->streaming = session->streaming;
+	config->lanes = READ_ONCE(tx->stripe_lanes);
+	config->priority = session->priority;
+	
+	mutex_lock(&tx->tx_mutex);
+	config->led = tx->pending_led;
+	config->time_unit_ns = tx->pending_time_unit_ns;
+	config->timer_hard = tx->timer_hard;
+	config->timer_cpu = tx->timer_cpu;
+	if (READ_ONCE(tx->config_pending)){
+		config->flags |= MORSE_CONFIG_PENDING;
+	}
+	mutex_unlock(&tx->tx_mutex);
+}
+
+/* stores time unit for timer, which takes it at next edge. Only if LED is idle, it is applied here */
+static int setRate(morse_transmitter* tx, unsigned long arg)
+{
+	struct morse_config config;
+	int ret_val;
+	
+	memset(&config, 0, sizeof(config));
+	config.flags = MORSE_CONFIG_TIME_UNIT;
+	if (get_user(config.time_unit_ns, (u64 __user *)arg)){
+		return -EFAULT;
+	}
+	ret_val = validateConfig(tx, &config);
+	if (ret_val != 0){
+		return ret_val;
+	}
+	
+	atomic64_set(&tx->live_time_unit_ns, config.time_unit_ns);
+	if (READ_ONCE(tx->blinking)){
+		return 0;
+	}
+	
+	/* timer is started only under tx_mutex, so if it isn't running now, nobody else takes request */
+	mutex_lock(&tx->tx_mutex);
+	if (!timerQueued(tx)){
+		applyLiveRate(tx, tx->deadline);
+		publishStatus(tx, 0);
+	}
+	mutex_unlock(&tx->tx_mutex);
+	
+	return 0;
+}
+
+/* queues next repeat of beacon, unless previous one still waits for LED. Called with tx_mutex held */
+static void queueBeacon(morse_transmitter* tx)
+{
+	morse_session* session = tx->beacon;
+	morse_message* message = NULL;
+	ktime_t now = ktime_get();
+	int waiting;
+	
+	if (!(tx->beacon_flags & MORSE_BEACON_GAP) && ktime_before(now, tx->beacon_next)){
+		/* work was queued by timer for beacon which was replaced meanwhile */
+		queue_delayed_work(system_power_efficient_wq, &tx->beacon_work, nsecs_to_jiffies(ktime_to_ns(ktime_sub(tx->beacon_next, now))));
+		return;
+	}
+	
+	/* with MORSE_BEACON_GAP also repeat on LED counts, its end queues next one. Messages are put only under tx_lock, so message read from stage or LED is never freed in meantime */
+	spin_lock(&tx->tx_lock);
+	message = READ_ONCE(tx->staged_message);
+	waiting = !kfifo_is_empty(&session->pending_messages) || (message != NULL && message->session == session);
+	message = READ_ONCE(tx->shown_message);
+	if ((tx->beacon_flags & MORSE_BEACON_GAP) && READ_ONCE(tx->blinking) && message != NULL && message->session == session){
+		waiting = 1;
+	}
+	spin_unlock(&tx->tx_lock);
+	message = NULL;
+	
+	if (!waiting){
+		message = reserveMessage(session);
+	}
+	if (message != NULL){
+		encodeMessage(session, message, tx->beacon_text, tx->beacon_length);
+		queueMessage(session, message);
+		stageNext(tx);
+		
+		if (tx->beacon_count != 0 && ++tx->beacon_repeats == tx->beacon_count){
+			/* last repeat is shown as any other message */
+			WRITE_ONCE(tx->beacon, NULL);
+			closeSession(session);
+			return;
+		}
+	}
+	
+	/* deadlines are absolute, so beacon doesn't drift by latency of work. Repeats which were missed are skipped */
+	if (!(tx->beacon_flags & MORSE_BEACON_GAP)){
+		while (!ktime_after(tx->beacon_next, now)){
+			tx->beacon_next = ktime_add_ns(tx->beacon_next, tx->beacon_period_ns);
+		}
+		queue_delayed_work(system_power_efficient_wq, &tx->beacon_work, nsecs_to_jiffies(ktime_to_ns(ktime_sub(tx->beacon_next, now))));
+	}
+}
+
+static void beaconWorkHandler(struct work_struct* work)
+{
+	morse_transmitter* tx = container_of(to_delayed_work(work), morse_transmitter, beacon_work);
+	
+	mutex_lock(&tx->tx_mutex);
+	if (tx->beacon != NULL){
+		queueBeacon(tx);
+	}
+	mutex_unlock(&tx->tx_mutex);
+	
+	wake_up_interruptible(&tx->read_wait);
+}
+
+/* replaces beacon of transmitter, length 0 only stops it */
+static int setBeacon(morse_session* session, unsigned long arg, size_t size)
+{
+	morse_transmitter* tx = session->tx;
+	struct morse_beacon beacon;
+	char text[MAX_NUM_OF_CHARS_TO_BE_ENCODED];
+	morse_session* beacon_session = NULL;
+	morse_session* replaced;
+	int ret_val;
+	
+	ret_val = copy_struct_from_user(&beacon, sizeof(beacon), (const void __user *)arg, size);
+	if (ret_val != 0){
+		return ret_val;
+	}
+	if (beacon.reserved != 0 || (beacon.flags & ~MORSE_BEACON_GAP) != 0){
+		return -EINVAL;
+	}
+	
+	if (beacon.length != 0){
+		if (beacon.period_ns < MIN_BEACON_PERIOD_NS || beacon.period_ns > MAX_BEACON_PERIOD_NS){
+			return -EINVAL;
+		}
+		beacon.length = min_t(u32, beacon.length, MAX_NUM_OF_CHARS_TO_BE_ENCODED);
+		if (copy_from_user(text, u64_to_user_ptr(beacon.text), beacon.length) != 0){
+			return -EFAULT;
+		}
+		
+		beacon_session = allocSession(tx);
+		if (beacon_session == NULL){
+			return -ENOMEM;
+		}
+		beacon_session->mode = session->mode;
+	}
+	
+	/* work takes tx_mutex, so it is cancelled before. If timer queues it again meanwhile, it finds new beacon and queues nothing ahead of time */
+	cancel_delayed_work_sync(&tx->beacon_work);
+	
+	mutex_lock(&tx->tx_mutex);
+	replaced = tx->beacon;
+	WRITE_ONCE(tx->beacon, NULL);
+	if (beacon_session != NULL){
+		memcpy(tx->beacon_text, text, beacon.length);
+		tx->beacon_length = beacon.length;
+		WRITE_ONCE(tx->beacon_flags, beacon.flags);
+		WRITE_ONCE(tx->beacon_period_ns, beacon.period_ns);
+		tx->beacon_count = beacon.count;
+		tx->beacon_repeats = 0;
+		tx->beacon_next = ktime_get();
+		WRITE_ONCE(tx->beacon, beacon_session);
+		queueBeacon(tx);
+	}
+	mutex_unlock(&tx->tx_mutex);
+	
+	if (replaced != NULL){
+		closeSession(replaced);
+	}
+	wake_up_interruptible(&tx->read_wait);
+	
+	return 0;
+}
+
+/* encodes template once, replaced one is freed when last message using it is */
+static int setTemplate(morse_session* session, unsigned long arg, size_t size)
+{
+	morse_transmitter* tx = session->tx;
+	struct morse_template_def def;
+	char text[MAX_NUM_OF_CHARS_TO_BE_ENCODED];
+	morse_template* template = NULL;
+	morse_template* replaced;
+	int ret_val;
+	
+	ret_val = copy_struct_from_user(&def, sizeof(def), (const void __user *)arg, size);
+	if (ret_val != 0){
+		return ret_val;
+	}
+	if (def.id >= MORSE_MAX_TEMPLATES){
+		return -EINVAL;
+	}
+	
+	if (def.length != 0){
+		def.length = min_t(u32, def.length, MAX_NUM_OF_CHARS_TO_BE_ENCODED);
+		if (copy_from_user(text, u64_to_user_ptr(def.text), def.length) != 0){
+			return -EFAULT;
+		}
+		
+		template = kvzalloc(sizeof(*template), GFP_KERNEL);
+		if (template == NULL){
+			return -ENOMEM;
+		}
+		template->refs = 1;
+		encode(tx, &template->encoding, text, def.length, session->mode);
+	}
+	
+	spin_lock(&tx->tx_lock);
+	replaced = tx->templates[def.id];
+	tx->templates[def.id] = template;
+	if (replaced != NULL){
+		putTemplate(replaced);
+	}
+	spin_unlock(&tx->tx_lock);
+	
+	return 0;
+}
+
+/* queues message which only points to encoding of template, nothing is copied or encoded */
+static int sendTemplate(struct file *file, morse_session* session, unsigned long id)
+{
+	morse_transmitter* tx = session->tx;
+	morse_template* template;
+	morse_message* message;
+	int ret_val;
+	
+	if (id >= MORSE_MAX_TEMPLATES){
+		return -EINVAL;
+	}
+	
+	spin_lock(&tx->tx_lock);
+	template = tx->templates[id];
+	if (template != NULL){
+		template->refs++;
+	}
+	spin_unlock(&tx->tx_lock);
+	if (template == NULL){
+		return -ENOENT;
+	}
+	
+	/* same as write, if queue is full wait until timer takes next message from it */
+	while ((message = reserveMessage(session)) == NULL){
+		if (file->f_flags & O_NONBLOCK){
+			ret_val = -EAGAIN;
+			goto error;
+		}
+		if (wait_event_interruptible(tx->write_wait, queueHasSpace(session))){
+			ret_val = -ERESTARTSYS;
+			goto error;
+		}
+	}
+	message->encoding = &template->encoding;
+	message->template = template;
+	
+	mutex_lock(&tx->tx_mutex);
+	queueMessage(session, message);
+	stageNext(tx);
+	mutex_unlock(&tx->tx_mutex);
+	
+	wake_up_interruptible(&tx->write_wait);
+	wake_up_interruptible(&tx->read_wait);
+	
+	return 0;
+	
+error:
+	spin_lock(&tx->tx_lock);
+	putTemplate(template);
+	spin_unlock(&tx->tx_lock);
+	
+	return ret_val;
+}
+
+/* commands of morse_ioctl.h, struct size is taken from command, so older and newer user space keeps working */
+static long ioctlConfig(struct file *file, morse_session* session, unsigned int cmd, unsigned long arg)
+{
+	morse_transmitter* tx = session->tx;
+	struct morse_config config;
+	size_t size = _IOC_SIZE(cmd);
+	int ret_val;
+	
+	if (cmd == MORSE_IOC_GET_VERSION){
+		return put_user((u32)MORSE_UAPI_VERSION, (u32 __user *)arg);
+	}
+	
+	if (_IOC_NR(cmd) == _IOC_NR(MORSE_IOC_SET_CONFIG) && _IOC_DIR(cmd) == _IOC_WRITE){
+		/* missing tail of older struct is taken as zero, unknown tail of newer one has to be zero */
+		ret_val = copy_struct_from_user(&config, sizeof(config), (const void __user *)arg, size);
+		if (ret_val != 0){
+			return ret_val;
+		}
+		ret_val = validateConfig(tx, &config);
+		if (ret_val != 0){
+			return ret_val;
+		}
+		applyConfig(session, &config);
+		
+		return 0;
+	}
+	
+	if (_IOC_NR(cmd) == _IOC_NR(MORSE_IOC_GET_CONFIG) && _IOC_DIR(cmd) == _IOC_READ){
+		getConfig(session, &config);
+		if (copy_to_user((void __user *)arg, &config, min(size, sizeof(config))) != 0){
+			return -EFAULT;
+		}
+		if (size > sizeof(config) && clear_user((char __user *)arg + sizeof(config), size - sizeof(config)) != 0){
+			return -EFAULT;
+		}
+		
+		return 0;
+	}
+	
+	if (_IOC_NR(cmd) == _IOC_NR(MORSE_IOC_SET_RATE) && _IOC_DIR(cmd) == _IOC_WRITE && size == sizeof(u64)){
+		return setRate(tx, arg);
+	}
+	
+	if (_IOC_NR(cmd) == _IOC_NR(MORSE_IOC_SET_BEACON) && _IOC_DIR(cmd) == _IOC_WRITE){
+		return setBeacon(session, arg, size);
+	}
+	
+	if (_IOC_NR(cmd) == _IOC_NR(MORSE_IOC_SET_TEMPLATE) && _IOC_DIR(cmd) == _IOC_WRITE){
+		return setTemplate(session, arg, size);
+	}
+	
+	if (cmd == MORSE_IOC_SEND_TEMPLATE){
+		return sendTemplate(file, session, arg);
+	}
+	
+	return -ENOTTY;
+}
+
+/* bare integer arg of old commands, too big ones are made invalid instead of being truncated */
+static u32 legacyArg(unsigned long arg)
+{
+	return (arg > U32_MAX) ? U32_MAX : arg;
+}
+
+static long ioctlCommand(struct file *file, unsigned int cmd, unsigned long arg){
+
+	morse_session* session = file->private_data;
+	morse_transmitter* tx = session->tx;
+	struct morse_config config;
+	int ret_val;
+	
+	if (_IOC_TYPE(cmd) == MORSE_IOC_MAGIC){
+		return ioctlConfig(file, session, cmd, arg);
+	}
+	
+	if (cmd == 5){
+		/* num of messages waiting in queue of this session (message on LED not included) */
+		return put_user((int)kfifo_len(&session->pending_messages), (int __user *)arg);
+	}
+	if (cmd == 6){
+		/* max num of messages waiting in queue of this session */
+		return put_user(QUEUE_CAPACITY, (int __user *)arg);
+	}
+	
+	/* every other bare integer command sets single field of morse_config, which is applied at once */
+	memset(&config, 0, sizeof(config));
+	config.flags = MORSE_CONFIG_NOW;
+	if (cmd == 0){
+		config.flags |= MORSE_CONFIG_MODE;
+		config.mode = legacyArg(arg);
+	}
+	if (cmd == 1){
+		config.flags |= MORSE_CONFIG_LED;
+		config.led = (arg == 0) ? LED_LEFT : LED_RIGHT;
+	}
+	if (cmd == 3){
+		/* time unit in ms */
+		config.flags |= MORSE_CONFIG_TIME_UNIT;
+		config.time_unit_ns = (u64)legacyArg(arg) * NSEC_PER_MSEC;
+	}
+	if (cmd == 4){
+		config.flags |= MORSE_CONFIG_READ_FORMAT;
+		config.read_format = (arg == 0) ? READ_ASCII : READ_PACKED;
+	}
+	if (cmd == 7){
+		config.flags |= MORSE_CONFIG_WEIGHT;
+		config.weight = legacyArg(arg);
+	}
+	if (cmd == 8){
+		config.flags |= MORSE_CONFIG_STREAMING;
+		config.streaming = (arg != 0);
+	}
+	if (cmd == 9){
+		/* time unit in ns, through u64 pointer */
+		config.flags |= MORSE_CONFIG_TIME_UNIT;
+		if (get_user(config.time_unit_ns, (u64 __user *)arg)){
+			return -EFAULT;
+		}
+	}
+	if (cmd == 10){
+		config.flags |= MORSE_CONFIG_LANES;
+		config.lanes = legacyArg(arg);
+	}
+	if (cmd == 11 || cmd == 12){
+		config.flags |= MORSE_CONFIG_TIMER;
+		config.timer_hard = (cmd == 11) ? legacyArg(arg) : tx->timer_hard;
+		config.timer_cpu = (cmd == 12) ? (((long)arg < -1 || (long)arg > INT_MAX) ? -2 : (long)arg) : tx->timer_cpu;
+	}
+	if (config.flags == MORSE_CONFIG_NOW){
+		return -ENOTTY;
+	}
+	
+	ret_val = validateConfig(tx, &config);
+	if (ret_val != 0){
+		return ret_val;
+	}
+	applyConfig(session, &config);
+	
+	return 0;
+}
+
+static long morse_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	morse_session* session = file->private_data;
+	morse_transmitter* tx = session->tx;
+	long ret_val = ioctlCommand(file, cmd, arg);
+	
+	trace_morse_ioctl(tx->id, cmd, arg, ret_val);
+	this_cpu_inc(tx->stats->ioctls);
+	if (ret_val != 0){
+		this_cpu_inc(tx->stats->ioctls_rejected);
+	}
+	
+	return ret_val;
+}
+
+#ifdef CONFIG_COMPAT
+/* 32-bit caller on 64-bit kernel: structs of morse_ioctl.h have same layout for it, so only pointer args are converted. Bare integer args are sign extended instead, so that -1 of cmd 12 (any CPU) stays -1 */
+static long morse_compat_ioctl(struct file *file, unsigned int cmd, unsigned long arg)
+{
+	if (_IOC_TYPE(cmd) == MORSE_IOC_MAGIC || cmd == 5 || cmd == 6 || cmd == 9){
+		return morse_ioctl(file, cmd, (unsigned long)compat_ptr(arg));
+	}
+	
+	return morse_ioctl(file, cmd, (unsigned long)(long)(s32)arg);
+}
+#endif
+
+static __poll_t morse_poll(struct file *file, poll_table *wait)
+{
+	morse_session* session = file->private_data;
+	morse_transmitter* tx = session->tx;
+	morse_message* message;
+	__poll_t mask = 0;
+	int available;
+	
+	poll_wait(file, &tx->write_wait, wait);
+	poll_wait(file, &tx->read_wait, wait);
+	
+	if (session->streaming ? !kfifo_is_full(&session->stream_data) : queueHasSpace(session)){
+		mask |= EPOLLOUT | EPOLLWRNORM;
+	}
+	
+	message = readableMessage(session);
+	if (message != NULL){
+		available = (session->format == READ_PACKED) ? MORSE_PACKED_SIZE(message->encoding->encodedDataLength) : message->encoding->encodedDataLength;
+		if (message->generation != session->read_generation || file->f_pos < available){
+			mask |= EPOLLIN | EPOLLRDNORM;
+		}
+		releaseMessage(message);
+	}
+	
+	return mask;
+}
+
+/* maps shared page read-only, monitoring tools poll it instead of calling read/ioctl */
+static int morse_mmap(struct file *file, struct vm_area_struct *vma)
+{
+	morse_session* session = file->private_data;
+	morse_transmitter* tx = session->tx;
+	
+	if (vma->vm_pgoff != 0 || vma->vm_end - vma->vm_start > PAGE_SIZE){
+		return -EINVAL;
+	}
+	if (vma->vm_flags & VM_WRITE){
+		return -EPERM;
+	}
+	
+	/* mprotect must not make it writable later */
+#if LINUX_VERSION_CODE >= KERNEL_VERSION(6, 3, 0)
+	vm_flags_clear(vma, VM_MAYWRITE);
+#else
+	vma->vm_flags &= ~VM_MAYWRITE;
+#endif
+	
+	return vm_insert_page(vma, vma->vm_start, virt_to_page(tx->shared_page));
+}
+
+module_init(morse_init);
+module_exit(morse_exit);
+
+MODULE_DESCRIPTION("Morse module");
+MODULE_AUTHOR("Darian Pudic");
+MODULE_LICENSE("GPL");
+
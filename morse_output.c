@@ -0,0 +1,317 @@
+#include <linux/module.h>
+#include <linux/kernel.h>
+#include <linux/gpio/consumer.h>
+#include <linux/gpio/machine.h>
+#include <linux/io.h>
+#include <linux/moduleparam.h>
+#include <linux/mutex.h>
+#include <linux/slab.h>
+#include <linux/workqueue.h>
+
+#include "morse_output.h"
+
+/* CONSTANTS AND TYPES */
+#define PHY_ADDR_SPC_PERIPH_START    0x3F200000	/* starting address of peripherals in ARM physical address space */
+#define PHY_ADDR_SPC_LEN 	     0x000000B4 /* size of address space */
+#define GPFSEL0_OFFSET  	     0x00000000	/* offset from starting address of first function select register, there is one for every 10 GPIOs */
+#define GPSET1_OFFSET   	     0x00000020 /* offset from starting address of set output register */
+#define GPCLR1_OFFSET   	     0x0000002C /* offset from starting address of clear output register */
+#define FIRST_GPIO_OF_BANK1 		     32 /* GPSET1/GPCLR1 control GPIO 32 - 53 */
+#define LAST_GPIO_OF_BANK1 		     53
+#define GPIO_FUNCTION_INPUT 		      0
+#define GPIO_FUNCTION_OUTPUT 		      1
+#define GPIOD_CON_ID 			"led"
+
+/* MMIO BACKEND DATA */
+static DEFINE_MUTEX(mmio_mutex);		/* serializes setup and release of transmitters, function select registers are read-modify-written */
+static void __iomem* virtualized_io_start_addr = NULL;
+static void __iomem* virtualized_GPSET1_addr = NULL;
+static void __iomem* virtualized_GPCLR1_addr = NULL;
+static int mmio_users = 0;			/* num of transmitters using mapping */
+static u32 mmio_claimed = 0;			/* GPSET1/GPCLR1 bits of GPIOs claimed by transmitters */
+
+/* set and clear registers change only bits which are written, so transmitters drive their GPIOs without any lock */
+typedef struct {
+	int gpios[MORSE_MAX_OUTPUTS];
+	int num_of_gpios;
+} mmio_data;
+
+/* GPIOD BACKEND DATA */
+static char* gpio_chip = "pinctrl-bcm2835";
+module_param(gpio_chip, charp, 0444);
+MODULE_PARM_DESC(gpio_chip, "Label of GPIO chip used by gpiod output (e.g. gpio-sim.0-node0), GPIO nums are offsets of its lines");
+
+typedef struct {
+	int gpios[MORSE_MAX_OUTPUTS];
+	int num_of_gpios;
+	struct gpiod_lookup_table* lookup;
+	struct gpio_descs* outputs;
+	unsigned long values;			/* bit i -> state of outputs->desc[i], changed only by drive */
+	int sleeping;				/* chip can sleep, so lines are set by work instead of caller of drive */
+	struct work_struct work;
+} gpiod_data;
+
+/* MMIO BACKEND */
+
+static void setGpioFunction(int gpio, u32 function)
+{
+	void __iomem* addr = virtualized_io_start_addr + GPFSEL0_OFFSET + 4 * (gpio / 10);
+	u32 tmp;
+
+	tmp = ioread32(addr);
+	tmp &= ~(7 << (3 * (gpio % 10)));
+	tmp |= function << (3 * (gpio % 10));
+	iowrite32(tmp, addr);
+}
+
+static u32 mmioGpioBit(void* data, int gpio)
+{
+	return 1 << (gpio - FIRST_GPIO_OF_BANK1);
+}
+
+static void* mmioSetup(struct device* device, const int* gpios, int num_of_gpios)
+{
+	mmio_data* mmio;
+	u32 bits = 0;
+	int ret;
+	int i = 0;
+
+	for (i = 0; i < num_of_gpios; i++){
+		if (gpios[i] < FIRST_GPIO_OF_BANK1 || gpios[i] > LAST_GPIO_OF_BANK1){
+			dev_err(device, "GPIO %d can't be driven through GPSET1/GPCLR1\n", gpios[i]);
+			return ERR_PTR(-EINVAL);
+		}
+		bits |= mmioGpioBit(NULL, gpios[i]);
+	}
+
+	mmio = kzalloc(sizeof(*mmio), GFP_KERNEL);
+	if (mmio == NULL){
+		return ERR_PTR(-ENOMEM);
+	}
+
+	mutex_lock(&mmio_mutex);
+
+	if (mmio_claimed & bits){
+		dev_err(device, "GPIO is already used by other transmitter\n");
+		ret = -EBUSY;
+		goto error;
+	}
+
+	/* mapping is shared by all transmitters */
+	if (mmio_users == 0){
+		virtualized_io_start_addr = ioremap(PHY_ADDR_SPC_PERIPH_START, PHY_ADDR_SPC_LEN);
+		if (virtualized_io_start_addr == NULL){
+			pr_err("Faield to virtualize IO\n");
+			ret = -ENOMEM;
+			goto error;
+		}
+		virtualized_GPSET1_addr = virtualized_io_start_addr + GPSET1_OFFSET;
+		virtualized_GPCLR1_addr = virtualized_io_start_addr + GPCLR1_OFFSET;
+	}
+	mmio_users++;
+	mmio_claimed |= bits;
+
+	/* setting GPIOs as output, LEDs are off initially */
+	for (i = 0; i < num_of_gpios; i++){
+		mmio->gpios[i] = gpios[i];
+		iowrite32(mmioGpioBit(mmio, gpios[i]), virtualized_GPCLR1_addr);
+		setGpioFunction(gpios[i], GPIO_FUNCTION_OUTPUT);
+	}
+	mmio->num_of_gpios = num_of_gpios;
+
+	mutex_unlock(&mmio_mutex);
+
+	return mmio;
+
+error:
+	mutex_unlock(&mmio_mutex);
+	kfree(mmio);
+
+	return ERR_PTR(ret);
+}
+
+static void mmioRelease(void* data)
+{
+	mmio_data* mmio = data;
+	int i = 0;
+
+	mutex_lock(&mmio_mutex);
+
+	for (i = 0; i < mmio->num_of_gpios; i++){
+		iowrite32(mmioGpioBit(mmio, mmio->gpios[i]), virtualized_GPCLR1_addr);
+		setGpioFunction(mmio->gpios[i], GPIO_FUNCTION_INPUT);	/* 000 value will make it input again */
+		mmio_claimed &= ~mmioGpioBit(mmio, mmio->gpios[i]);
+	}
+
+	if (--mmio_users == 0){
+		iounmap(virtualized_io_start_addr);
+		virtualized_io_start_addr = NULL;
+	}
+
+	mutex_unlock(&mmio_mutex);
+
+	kfree(mmio);
+}
+
+static void mmioDrive(void* data, u32 set, u32 clear)
+{
+	if (set != 0){
+		iowrite32(set, virtualized_GPSET1_addr);
+	}
+	if (clear != 0){
+		iowrite32(clear, virtualized_GPCLR1_addr);
+	}
+}
+
+/* all transmitters share GPSET1/GPCLR1 and their GPIOs never overlap, so their words are simply merged */
+static void mmioDriveEdges(const morse_output_edge* edges, int num_of_edges)
+{
+	u32 set = 0;
+	u32 clear = 0;
+	int i = 0;
+
+	for (i = 0; i < num_of_edges; i++){
+		set |= edges[i].set;
+		clear |= edges[i].clear;
+	}
+
+	mmioDrive(NULL, set, clear);
+}
+
+const morse_output morse_output_mmio = {
+	.name = "mmio",
+	.setup = mmioSetup,
+	.release = mmioRelease,
+	.gpioBit = mmioGpioBit,
+	.drive = mmioDrive,
+	.driveEdges = mmioDriveEdges
+};
+
+/* GPIOD BACKEND */
+
+static u32 gpiodGpioBit(void* data, int gpio)
+{
+	gpiod_data* gpiod = data;
+	int i = 0;
+
+	for (i = 0; i < gpiod->num_of_gpios; i++){
+		if (gpiod->gpios[i] == gpio){
+			return 1 << i;
+		}
+	}
+
+	return 0;
+}
+
+static void gpiodWorkHandler(struct work_struct* work)
+{
+	gpiod_data* gpiod = container_of(work, gpiod_data, work);
+	unsigned long values = READ_ONCE(gpiod->values);
+
+	gpiod_set_array_value_cansleep(gpiod->outputs->ndescs, gpiod->outputs->desc, gpiod->outputs->info, &values);
+}
+
+static void* gpiodSetup(struct device* device, const int* gpios, int num_of_gpios)
+{
+	gpiod_data* gpiod;
+	int ret;
+	int i = 0;
+
+	gpiod = kzalloc(sizeof(*gpiod), GFP_KERNEL);
+	if (gpiod == NULL){
+		return ERR_PTR(-ENOMEM);
+	}
+	INIT_WORK(&gpiod->work, gpiodWorkHandler);
+
+	/* GPIOs are described by machine lookup table of transmitter device, so gpiolib finds them without device tree */
+	gpiod->lookup = kzalloc(struct_size(gpiod->lookup, table, num_of_gpios + 1), GFP_KERNEL);
+	if (gpiod->lookup == NULL){
+		ret = -ENOMEM;
+		goto lookup_error;
+	}
+	gpiod->lookup->dev_id = dev_name(device);
+	for (i = 0; i < num_of_gpios; i++){
+		gpiod->lookup->table[i] = (struct gpiod_lookup)GPIO_LOOKUP_IDX(gpio_chip, gpios[i], GPIOD_CON_ID, i, GPIO_ACTIVE_HIGH);
+		gpiod->gpios[i] = gpios[i];
+	}
+	gpiod->num_of_gpios = num_of_gpios;
+	gpiod_add_lookup_table(gpiod->lookup);
+
+	/* LEDs are off initially */
+	gpiod->outputs = gpiod_get_array(device, GPIOD_CON_ID, GPIOD_OUT_LOW);
+	if (IS_ERR(gpiod->outputs)){
+		dev_err(device, "Failed to get GPIOs of %s\n", gpio_chip);
+		ret = PTR_ERR(gpiod->outputs);
+		goto get_error;
+	}
+
+	for (i = 0; i < gpiod->outputs->ndescs; i++){
+		if (gpiod_cansleep(gpiod->outputs->desc[i])){
+			gpiod->sleeping = 1;
+		}
+	}
+	if (gpiod->sleeping){
+		dev_info(device, "GPIO chip %s can sleep, edges are delayed by workqueue latency\n", gpio_chip);
+	}
+
+	return gpiod;
+
+get_error:
+	gpiod_remove_lookup_table(gpiod->lookup);
+	kfree(gpiod->lookup);
+
+lookup_error:
+	kfree(gpiod);
+
+	return ERR_PTR(ret);
+}
+
+static void gpiodRelease(void* data)
+{
+	gpiod_data* gpiod = data;
+
+	cancel_work_sync(&gpiod->work);
+
+	gpiod->values = 0;
+	gpiod_set_array_value_cansleep(gpiod->outputs->ndescs, gpiod->outputs->desc, gpiod->outputs->info, &gpiod->values);
+
+	gpiod_put_array(gpiod->outputs);
+	gpiod_remove_lookup_table(gpiod->lookup);
+	kfree(gpiod->lookup);
+	kfree(gpiod);
+}
+
+static void gpiodDrive(void* data, u32 set, u32 clear)
+{
+	gpiod_data* gpiod = data;
+
+	WRITE_ONCE(gpiod->values, (gpiod->values | set) & ~(unsigned long)clear);
+
+	if (gpiod->sleeping){
+		/* if worker is behind, it shows only latest state */
+		queue_work(system_highpri_wq, &gpiod->work);
+		return;
+	}
+
+	/* chips which implement set_multiple switch all lines at once */
+	gpiod_set_array_value(gpiod->outputs->ndescs, gpiod->outputs->desc, gpiod->outputs->info, &gpiod->values);
+}
+
+/* descriptors of transmitters are separate arrays, so each transmitter is set by its own call */
+static void gpiodDriveEdges(const morse_output_edge* edges, int num_of_edges)
+{
+	int i = 0;
+
+	for (i = 0; i < num_of_edges; i++){
+		gpiodDrive(edges[i].data, edges[i].set, edges[i].clear);
+	}
+}
+
+const morse_output morse_output_gpiod = {
+	.name = "gpiod",
+	.setup = gpiodSetup,
+	.release = gpiodRelease,
+	.gpioBit = gpiodGpioBit,
+	.drive = gpiodDrive,
+	.driveEdges = gpiodDriveEdges
+};
@@ -0,0 +1,34 @@
+#ifndef MORSE_OUTPUT_H
+#define MORSE_OUTPUT_H
+
+/* LED output backends of the kernel module (morse_dev.ko). Every transmitter sets up its own GPIOs and gets data of its own, which is passed to all other ops. Driver sees GPIOs of transmitter as bits of u32 word (see gpioBit), timer switches them by passing words of GPIOs to be set and cleared to drive */
+
+#include <linux/device.h>
+#include <linux/types.h>
+
+/* CONSTANTS AND TYPES */
+#define MORSE_MAX_OUTPUTS 		     10 /* both LEDs plus MORSE_MAX_LANES stripe GPIOs, per transmitter */
+
+/* output words of single transmitter */
+typedef struct {
+	void* data;
+	u32 set;
+	u32 clear;
+} morse_output_edge;
+
+typedef struct {
+	const char* name;				/* value of output module parameter which selects backend */
+	void* (*setup)(struct device* device, const int* gpios, int num_of_gpios);	/* claims gpios for device and makes them outputs which are off, returns data of transmitter or ERR_PTR */
+	void (*release)(void* data);			/* turns outputs off and gives them back */
+	u32 (*gpioBit)(void* data, int gpio);		/* bit of gpio in words passed to drive, gpio has to be one passed to setup */
+	void (*drive)(void* data, u32 set, u32 clear);	/* called from timer (hard or soft IRQ context) or while timer is cancelled, never concurrently for same data */
+	void (*driveEdges)(const morse_output_edge* edges, int num_of_edges);	/* edges of several transmitters due together, with as few writes as backend allows. Called from timer */
+} morse_output;
+
+/* raw BCM2837 GPIO registers, GPIOs 32 - 53 only, each of them used by single transmitter. All edges of single drive or driveEdges call are applied by single register write */
+extern const morse_output morse_output_mmio;
+
+/* gpiolib descriptors of lines of chip named by gpio_chip module parameter (GPIO num is line offset), works with any GPIO controller incl. gpio-sim. led-gpios property of device tree node of transmitter takes precedence, it has to list same lines in same order as gpios passed to setup. Chips which can sleep are driven from high priority workqueue */
+extern const morse_output morse_output_gpiod;
+
+#endif /* MORSE_OUTPUT_H */
@@ -0,0 +1,64 @@
+#ifndef MORSE_SHARED_H
+#define MORSE_SHARED_H
+
+/* Layout of read-only page which every /dev/morse_dev<N> exposes through mmap (offset 0, at most one page). Driver updates it, monitoring tools read it without any syscall */
+
+#include "morse_encoder.h"
+
+/* CONSTANTS AND TYPES */
+#define MORSE_STREAM_SIZE 	(MORSE_PACKED_SIZE(MAX_NUM_OF_CHARS_TO_BE_ENCODED * ENCODED_CHAR_MAX_LENGTH) + MORSE_PACKED_SLACK)
+#define MORSE_CACHE_LINE 	64 /* status and stream are written from different contexts, so they don't share cache line */
+
+/* Both blocks are protected by their own sequence counter: it is odd while driver updates block, so reader has to repeat reading while it is odd or while it changed during reading (see morse_seq_begin() and morse_seq_retry()) */
+
+/* transmitter state, updated by timer at every LED edge */
+typedef struct {
+	u32 sequence;
+	u32 active;		/* 1 while message is being shown on LED */
+	u32 generation;		/* generation of message on LED (or shown last) */
+	u32 length;		/* num of symbols of message on LED */
+	u32 run;		/* num of runs of its edge schedule already started (run - 1 is on LED) */
+	u32 runs;		/* num of runs in its edge schedule */
+	u32 elapsed_units;	/* units from message start to end of run on LED */
+	u32 mode;		/* work_mode */
+	u32 led;		/* 0 -> left, 1 -> right */
+	u32 lanes;		/* num of LEDs messages are striped across */
+	u32 late_edges;		/* num of edges shown more than half of time unit after their deadline, since time unit was set */
+	u64 time_unit_ns;
+} __attribute__((aligned(MORSE_CACHE_LINE))) morse_status;
+
+/* last written message, updated by write */
+typedef struct {
+	u32 sequence;
+	u32 generation;		/* num of successful writes so far, changes with every new message */
+	u32 length;		/* num of packed symbols in data */
+	u8 data[MORSE_STREAM_SIZE];	/* packed symbols (see morse_encoder.h) */
+} __attribute__((aligned(MORSE_CACHE_LINE))) morse_stream;
+
+typedef struct {
+	morse_status status;
+	morse_stream stream;
+} morse_shared_page;
+
+#ifndef __KERNEL__
+/* Usage: do { seq = morse_seq_begin(&page->status.sequence); ...copy fields... } while (morse_seq_retry(&page->status.sequence, seq)); */
+static inline u32 morse_seq_begin(const u32* sequence)
+{
+	u32 seq;
+
+	while ((seq = __atomic_load_n(sequence, __ATOMIC_ACQUIRE)) & 1){
+		/* driver is in the middle of update */
+	}
+
+	return seq;
+}
+
+static inline int morse_seq_retry(const u32* sequence, u32 seq)
+{
+	__atomic_thread_fence(__ATOMIC_ACQUIRE);
+
+	return __atomic_load_n(sequence, __ATOMIC_RELAXED) != seq;
+}
+#endif
+
+#endif /* MORSE_SHARED_H */
@@ -0,0 +1,165 @@
+/* Tracepoints of the kernel module (morse_dev.ko), available as events/morse in tracefs (perf trace -e 'morse:*'). They cost one static branch while disabled, so they are placed on hot paths where printk can't be. Every event carries minor num of its transmitter (id) */
+
+#undef TRACE_SYSTEM
+#define TRACE_SYSTEM morse
+
+#if !defined(MORSE_TRACE_H) || defined(TRACE_HEADER_MULTI_READ)
+#define MORSE_TRACE_H
+
+#include <linux/ktime.h>
+#include <linux/tracepoint.h>
+
+/* result of write, ret is num of accepted bytes or negative errno */
+DECLARE_EVENT_CLASS(morse_write_class,
+	TP_PROTO(int id, size_t count, ssize_t ret, int streaming, int busy),
+	TP_ARGS(id, count, ret, streaming, busy),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(size_t, count)
+		__field(ssize_t, ret)
+		__field(int, streaming)
+		__field(int, busy)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->count = count;
+		__entry->ret = ret;
+		__entry->streaming = streaming;
+		__entry->busy = busy;
+	),
+	TP_printk("id=%d count=%zu ret=%zd streaming=%d busy=%d", __entry->id, __entry->count, __entry->ret, __entry->streaming, __entry->busy)
+);
+
+DEFINE_EVENT(morse_write_class, morse_write_accepted,
+	TP_PROTO(int id, size_t count, ssize_t ret, int streaming, int busy),
+	TP_ARGS(id, count, ret, streaming, busy)
+);
+
+DEFINE_EVENT(morse_write_class, morse_write_rejected,
+	TP_PROTO(int id, size_t count, ssize_t ret, int streaming, int busy),
+	TP_ARGS(id, count, ret, streaming, busy)
+);
+
+TRACE_EVENT(morse_encode_start,
+	TP_PROTO(int id, int chars, int mode, int lanes),
+	TP_ARGS(id, chars, mode, lanes),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(int, chars)
+		__field(int, mode)
+		__field(int, lanes)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->chars = chars;
+		__entry->mode = mode;
+		__entry->lanes = lanes;
+	),
+	TP_printk("id=%d chars=%d mode=%d lanes=%d", __entry->id, __entry->chars, __entry->mode, __entry->lanes)
+);
+
+TRACE_EVENT(morse_encode_end,
+	TP_PROTO(int id, int chars, int symbols, int runs),
+	TP_ARGS(id, chars, symbols, runs),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(int, chars)
+		__field(int, symbols)
+		__field(int, runs)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->chars = chars;
+		__entry->symbols = symbols;
+		__entry->runs = runs;
+	),
+	TP_printk("id=%d chars=%d symbols=%d runs=%d", __entry->id, __entry->chars, __entry->symbols, __entry->runs)
+);
+
+/* message got its generation and waits for LED, edges of message carry same generation */
+TRACE_EVENT(morse_message_queued,
+	TP_PROTO(int id, u32 generation, int symbols, unsigned int depth),
+	TP_ARGS(id, generation, symbols, depth),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(u32, generation)
+		__field(int, symbols)
+		__field(unsigned int, depth)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->generation = generation;
+		__entry->symbols = symbols;
+		__entry->depth = depth;
+	),
+	TP_printk("id=%d generation=%u symbols=%d depth=%u", __entry->id, __entry->generation, __entry->symbols, __entry->depth)
+);
+
+TRACE_EVENT(morse_ioctl,
+	TP_PROTO(int id, unsigned int cmd, unsigned long arg, long ret),
+	TP_ARGS(id, cmd, arg, ret),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(unsigned int, cmd)
+		__field(unsigned long, arg)
+		__field(long, ret)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->cmd = cmd;
+		__entry->arg = arg;
+		__entry->ret = ret;
+	),
+	TP_printk("id=%d cmd=%u arg=0x%lx ret=%ld", __entry->id, __entry->cmd, __entry->arg, __entry->ret)
+);
+
+/* LED edge, run is index in edge schedule of message (run == num of runs is final switch off) */
+TRACE_EVENT(morse_edge,
+	TP_PROTO(int id, u32 generation, int run, u32 led_on, ktime_t scheduled, ktime_t actual),
+	TP_ARGS(id, generation, run, led_on, scheduled, actual),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(u32, generation)
+		__field(int, run)
+		__field(u32, led_on)
+		__field(s64, late_ns)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->generation = generation;
+		__entry->run = run;
+		__entry->led_on = led_on;
+		__entry->late_ns = ktime_to_ns(ktime_sub(actual, scheduled));
+	),
+	TP_printk("id=%d generation=%u run=%d led_on=0x%x late_ns=%lld", __entry->id, __entry->generation, __entry->run, __entry->led_on, __entry->late_ns)
+);
+
+/* message of higher priority class suspended message on LED at gap before its run, latency is time from staging of preempting message to its first edge */
+TRACE_EVENT(morse_preempt,
+	TP_PROTO(int id, u32 suspended, int run, u32 generation, u64 latency_ns),
+	TP_ARGS(id, suspended, run, generation, latency_ns),
+	TP_STRUCT__entry(
+		__field(int, id)
+		__field(u32, suspended)
+		__field(int, run)
+		__field(u32, generation)
+		__field(u64, latency_ns)
+	),
+	TP_fast_assign(
+		__entry->id = id;
+		__entry->suspended = suspended;
+		__entry->run = run;
+		__entry->generation = generation;
+		__entry->latency_ns = latency_ns;
+	),
+	TP_printk("id=%d suspended=%u run=%d generation=%u latency_ns=%llu", __entry->id, __entry->suspended, __entry->run, __entry->generation, __entry->latency_ns)
+);
+
+#endif /* MORSE_TRACE_H */
+
+/* This part must be outside protection */
+#undef TRACE_INCLUDE_PATH
+#define TRACE_INCLUDE_PATH .
+#undef TRACE_INCLUDE_FILE
+#define TRACE_INCLUDE_FILE morse_trace
+#include <trace/define_trace.h>
@@ -20,6 +20,6 @@ else
  exit 1
 fi
 
-./test_app /dev/morse_dev
+./test_app /dev/morse_dev0
 
 exit 0
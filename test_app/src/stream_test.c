@@ -0,0 +1,163 @@
+#include <stdlib.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+
+#include "../../morse_ioctl.h"
+#include "../../morse_shared.h"
+
+/* Two sessions of same class stream text at once, each of them character of different encoded length. Every chunk of streamed text is message of its own, so length of message on LED (taken from mmap-ed status) tells which session it came from. Streamed text must not be split by the other session, so that length may change only once */
+
+/* CONSTANTS AND TYPES */
+#define NUM_OF_SESSIONS 2
+#define STREAM_TEST_LENGTH 256			/* chars streamed by each session, many chunks of driver */
+#define TIME_UNIT_NS 100000ULL			/* whole test is shown in about one second */
+#define IDLE_TIMEOUT_NS 200000000ULL		/* streaming is over once LED stays idle this long */
+#define TEST_TIMEOUT_NS 30000000000ULL
+
+const char stream_chars[NUM_OF_SESSIONS] = {
+	'E',	/* shortest character */
+	'0'	/* one of longest ones */
+};
+
+/* FUNCTION DEFINITIONS */
+
+static unsigned long long now_ns(void)
+{
+	struct timespec ts;
+
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+
+	return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static void readStatus(const morse_shared_page* page, morse_status* status)
+{
+	u32 seq;
+
+	do {
+		seq = morse_seq_begin(&page->status.sequence);
+		memcpy(status, (const void*)&page->status, sizeof(*status));
+	} while (morse_seq_retry(&page->status.sequence, seq));
+}
+
+int main(int argc, char* argv[])
+{
+	int device_files[NUM_OF_SESSIONS];
+	struct morse_config config;
+	struct morse_config saved_config;
+	const morse_shared_page* page;
+	morse_status status;
+	char text[STREAM_TEST_LENGTH];
+	u32 last_generation;
+	u32 last_length = 0;
+	int shown = 0;
+	int switches = 0;
+	unsigned long long start;
+	unsigned long long last_active;
+	int ret_val = 0;
+	int i = 0;
+
+	if (argc != 2) {
+		printf("Wrong number of arguments\n");
+		return -1;
+	}
+
+	for (i = 0; i < NUM_OF_SESSIONS; i++){
+		device_files[i] = open(argv[1], O_RDWR);
+		if (device_files[i] < 0) {
+			printf("Error opening device handle\n");
+			return -1;
+		}
+
+		memset(&config, 0, sizeof(config));
+		config.flags = MORSE_CONFIG_STREAMING;
+		config.streaming = 1;
+		if (ioctl(device_files[i], MORSE_IOC_SET_CONFIG, &config)) {
+			printf("Error during ioctl call: %s\n", strerror(errno));
+			return -1;
+		}
+	}
+
+	/* short time unit, previous one is restored at the end */
+	if (ioctl(device_files[0], MORSE_IOC_GET_CONFIG, &saved_config)) {
+		printf("Error during ioctl call: %s\n", strerror(errno));
+		return -1;
+	}
+	memset(&config, 0, sizeof(config));
+	config.flags = MORSE_CONFIG_TIME_UNIT | MORSE_CONFIG_NOW;
+	config.time_unit_ns = TIME_UNIT_NS;
+	if (ioctl(device_files[0], MORSE_IOC_SET_CONFIG, &config)) {
+		printf("Error during ioctl call: %s\n", strerror(errno));
+		return -1;
+	}
+
+	page = mmap(NULL, sizeof(morse_shared_page), PROT_READ, MAP_SHARED, device_files[0], 0);
+	if (page == MAP_FAILED) {
+		printf("Error mapping status page: %s\n", strerror(errno));
+		return -1;
+	}
+
+	/* messages shown before test are not counted */
+	readStatus(page, &status);
+	last_generation = status.generation;
+
+	/* stream buffer of session is far bigger than text, so both writes return at once and sessions compete for LED */
+	for (i = 0; i < NUM_OF_SESSIONS; i++){
+		memset(text, stream_chars[i], STREAM_TEST_LENGTH);
+		if (write(device_files[i], text, STREAM_TEST_LENGTH) != STREAM_TEST_LENGTH){
+			printf("Writing to device failed: %s\n", strerror(errno));
+			return -1;
+		}
+	}
+
+	start = now_ns();
+	last_active = start;
+	while (now_ns() - last_active < IDLE_TIMEOUT_NS){
+		if (now_ns() - start > TEST_TIMEOUT_NS){
+			printf("Streamed text was not shown in time\n");
+			ret_val = -1;
+			break;
+		}
+
+		readStatus(page, &status);
+		if (status.active){
+			last_active = now_ns();
+			if (status.generation != last_generation){
+				if (shown > 0 && status.length != last_length){
+					switches++;
+				}
+				last_generation = status.generation;
+				last_length = status.length;
+				shown++;
+			}
+		}
+	}
+
+	printf("Shown %d chunks, LED switched between sessions %d times\n", shown, switches);
+	if (ret_val == 0){
+		if (shown == 0 || switches > 1){
+			printf("Test failed\n");
+			ret_val = -1;
+		} else{
+			printf("Test passed\n");
+		}
+	}
+
+	memset(&config, 0, sizeof(config));
+	config.flags = MORSE_CONFIG_TIME_UNIT | MORSE_CONFIG_NOW;
+	config.time_unit_ns = saved_config.time_unit_ns;
+	ioctl(device_files[0], MORSE_IOC_SET_CONFIG, &config);
+
+	munmap((void*)page, sizeof(morse_shared_page));
+	for (i = 0; i < NUM_OF_SESSIONS; i++){
+		close(device_files[i]);
+	}
+
+	return ret_val;
+}
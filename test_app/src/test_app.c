@@ -14,6 +14,7 @@
 #define MAX_NUM_OF_CHARS 50
 #define MAX_NUM_OF_ENCODED_CHARS 1000
 #define PATH_TO_DEV_LENGTH 50
+#define NUM_OF_HIGH_SPEED_UNITS 4
 
 typedef enum {
 	IDLE,
@@ -49,7 +50,15 @@ const char* test_vector_outputs[] = {
 	"* -   - * * *       - * - *   - * *   "
 };
 
-//const char* dev_path = "/dev/morse_dev";
+/* short time units offered for high-speed link, in ns (driver accepts down to 10 us) */
+const unsigned long long high_speed_units_ns[] = {
+	1000000,
+	100000,
+	50000,
+	20000
+};
+
+//const char* dev_path = "/dev/morse_dev0";
 char dev_path[PATH_TO_DEV_LENGTH];
 
 /* FUNCTION PROTOTYPES */
@@ -66,11 +75,15 @@ static pthread_mutex_t sharedResource;
 static pthread_mutex_t sharedResourceTimer;
 int enablePeriodicWriting = 0;
 
+/* device, opened once, so mode set through ioctl applies to following writes (driver keeps configuration per open) */
+int device_file = -1;
+
 /* data holders */
 work_mode current_work_mode = IDLE;
 unsigned int cmd;
 unsigned long arg;
 char encodedData[MAX_NUM_OF_ENCODED_CHARS];
+unsigned long long time_unit_ns; /* passed to driver by pointer */
 char expectedEncodedData[MAX_NUM_OF_ENCODED_CHARS];
 char dataToBeEncoded[MAX_NUM_OF_CHARS];
 int error_mode = 0;
@@ -80,55 +93,25 @@ int error_mode = 0;
 /* function which triggers write function on driver's side */
 int sendDataToEncoding(char* charsToBeEncoded, int len)
 {
-	int file_desc;
-	int ret_val = 0;
-
-	/* Open /dev/morse_dev device. */
-	file_desc = open(dev_path, O_RDWR);
-
-	if(file_desc < 0)
-	{
-		printf("Error opening device handle\n");
-		ret_val = file_desc;
-
-		return ret_val;
-	}
-
 	/* Write to /dev/morse_dev device */
-	ret_val = write(file_desc, charsToBeEncoded, len);
-	
-	/* Close /dev/morse_dev device */
-    	close(file_desc);
-    	
-    	return ret_val;
+	return write(device_file, charsToBeEncoded, len);
 }
 
 /* function which triggers read function on driver's side */
 void readEncodedData(void)
 {
-	int file_desc;
-	
 	/* Init buffer where encoded data from driver will be placed */
     	memset(encodedData, 0, MAX_NUM_OF_ENCODED_CHARS);
-
-	/* Open /dev/morse_dev device. */
-	file_desc = open(dev_path, O_RDWR);
-
-	if(file_desc < 0)
-	{
-		printf("Error opening device handle\n");
-
-		return -1;
-	}
 	
-	/* read from /dev/morse_dev device */
-	read(file_desc, encodedData, MAX_NUM_OF_ENCODED_CHARS);
+	/* read from /dev/morse_dev device, always from beginning of last written message */
+	pread(device_file, encodedData, MAX_NUM_OF_ENCODED_CHARS, 0);
 }
 
 /* input thread routine. */
 void* inputThreadRoutine (void *param)
 {
     char c;
+    int i = 0;
     
     while (1)
     {
@@ -189,6 +172,10 @@ void* inputThreadRoutine (void *param)
 				printf("1. Which LED blinks\n");
 				printf("2. Length of one time unit\n");
 				printf("3. Driver encodes data with or without errors\n");
+				printf("4. Length of one time unit for high-speed link\n");
+				printf("5. Num of LEDs message is striped across\n");
+				printf("6. Timer expiry context (for jitter measurement, see debugfs morse_dev/morse_dev<N>/jitter)\n");
+				printf("7. CPU timer is pinned to (for jitter measurement, see debugfs morse_dev/morse_dev<N>/jitter)\n");
 				
 				c = getch(); /* long waiting for input may cause long delays, because we are holding mutex locked! */
 				
@@ -252,7 +239,86 @@ void* inputThreadRoutine (void *param)
 								}						
 							}						
 						} else{
-							printf("Not supported selection\n");
+							if (c == '4'){
+								cmd = 9;
+								
+								printf("\n");
+								for (i = 0; i < NUM_OF_HIGH_SPEED_UNITS; i++){
+									printf("%d. %llu us\n", i + 1, high_speed_units_ns[i] / 1000);
+								}
+								
+								c = getch(); /* long waiting for input may cause long delays, because we are holding mutex locked! */
+								
+								if (c >= '1' && c < '1' + NUM_OF_HIGH_SPEED_UNITS){
+									time_unit_ns = high_speed_units_ns[c - '1'];
+									arg = (unsigned long)&time_unit_ns;
+									
+									printf("Configuration done\n");
+								} else{
+									printf("Not supported selection\n");
+								}
+							} else{
+								if (c == '5'){
+									cmd = 10;
+									
+									printf("\n");
+									printf("1. One LED (chosen by option 1)\n");
+									printf("2. Both LEDs, each shows half of message\n");
+									
+									c = getch(); /* long waiting for input may cause long delays, because we are holding mutex locked! */
+									
+									if (c == '1' || c == '2'){
+										arg = c - '0';
+										
+										printf("Configuration done\n");
+									} else{
+										printf("Not supported selection\n");
+									}
+								} else{
+									if (c == '6'){
+										cmd = 11;
+										
+										printf("\n");
+										printf("1. Softirq (default on PREEMPT_RT kernels)\n");
+										printf("2. Hard IRQ\n");
+										
+										c = getch(); /* long waiting for input may cause long delays, because we are holding mutex locked! */
+										
+										if (c == '1' || c == '2'){
+											arg = c - '1';
+											
+											printf("Configuration done\n");
+										} else{
+											printf("Not supported selection\n");
+										}
+									} else{
+										if (c == '7'){
+											cmd = 12;
+											
+											printf("\n");
+											printf("Enter CPU num (from set [0..9]) or a for any CPU\n");
+											
+											c = getch(); /* long waiting for input may cause long delays, because we are holding mutex locked! */
+											
+											if (c >= '0' && c <= '9'){
+												arg = c - '0';
+												
+												printf("Configuration done\n");
+											} else{
+												if (c == 'a'){
+													arg = (unsigned long)-1;
+													
+													printf("Configuration done\n");
+												} else{
+													printf("Not supported selection\n");
+												}
+											}
+										} else{
+											printf("Not supported selection\n");
+										}
+									}
+								}
+							}
 						}
 					}
 				}				
@@ -349,7 +415,6 @@ void* inputThreadRoutine (void *param)
 void* processingThreadRoutine (void *param)
 {
     work_mode current_work_mode_local;
-    int file;
     
     while (1)
     {
@@ -406,14 +471,12 @@ void* processingThreadRoutine (void *param)
 					
 					/* trigger write function on driver's side */
 					if (sendDataToEncoding(dataToBeEncoded, strlen(dataToBeEncoded)) <= 0){
-						printf("Writing to device failed (either device file handle couldn't be opened or LED is still blinking)\n");
+						printf("Writing to device failed: %s\n", strerror(errno));
 					} else{
 						printf("Encoding: %s\n", dataToBeEncoded);
 						printf("Expected output is: %s\n", expectedEncodedData);
 						
-						/* writing is successful */
-						usleep(2000); /* encoding is really quick, but just in case */
-					
+						/* writing is successful, write returns only after data is encoded, so it can be read right away */
 						/* trigger read function on driver's side */
 						readEncodedData();
 						
@@ -440,15 +503,8 @@ void* processingThreadRoutine (void *param)
 				pthread_mutex_lock(&sharedResource);				
 					
 					/* perform io call to driver to notify it */
-					if ((file = open(dev_path, O_RDWR)) < 0) {
-						printf("Error opening device handle\n");
-						pthread_mutex_unlock(&sharedResource);
-						
-						return -1;
-				  	}
-					
 					//printf("CMD: %d, ARG: %d\n", cmd, arg);
-					if (ioctl(file, cmd, arg)) {
+					if (ioctl(device_file, cmd, arg)) {
 						printf("Error during ioctl call: %s\n", strerror(errno));
 						//printf("Cmd: %d\n", cmd);
 						//printf("Arg: %d\n", arg);
@@ -456,8 +512,6 @@ void* processingThreadRoutine (void *param)
 						
 						return -1;
 				  	}		  	
-				  				  	
-					close(file);
 					
 				pthread_mutex_unlock(&sharedResource);
 			
@@ -506,13 +560,11 @@ void* timerThreadRoutine (void *param)
 				
 				/* trigger write function on driver's side */
 				if (sendDataToEncoding(dataToBeEncoded, strlen(dataToBeEncoded)) <= 0){
-					printf("Writing to device failed (either device file handle couldn't be opened or LED is still blinking)\n");
+					printf("Writing to device failed: %s\n", strerror(errno));
 				} else{
 					printf("Encoding: %s\n", dataToBeEncoded);
 					
-					/* writing is successful */
-					usleep(2000); /* encoding is really quick, but just in case */
-				
+					/* writing is successful, write returns only after data is encoded, so it can be read right away */
 					/* trigger read function on driver's side */
 					readEncodedData();
 					
@@ -540,6 +592,13 @@ int main (int argc, char *argv[])
 	memset(dev_path, 0, PATH_TO_DEV_LENGTH);
 	memcpy(dev_path, argv[1], strlen(argv[1]));
 	
+	/* Open /dev/morse_dev device. */
+	device_file = open(dev_path, O_RDWR);
+	if (device_file < 0) {
+		printf("Error opening device handle\n");
+		return -1;
+	}
+	
 	/* Thread IDs. */
 	pthread_t inputHandlingThread;
 	pthread_t processingHandlingThread;   
@@ -569,6 +628,9 @@ int main (int argc, char *argv[])
 	sem_destroy(&semFinishSignal);
 	pthread_mutex_destroy(&sharedResource);
 	pthread_mutex_destroy(&sharedResourceTimer);
+	
+	/* Close /dev/morse_dev device */
+	close(device_file);
 
 	printf("\n");
 